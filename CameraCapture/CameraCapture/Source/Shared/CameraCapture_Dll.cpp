@@ -9,6 +9,8 @@
 
 #include "Plugin.CaptureEngine.h"
 #include "Media.PayloadHandler.h"
+#include "Media.Prewarm.h"
+#include "Media.FrameLatency.h"
 
 namespace impl
 {
@@ -68,6 +70,7 @@ HRESULT TrackModule(winrt::Module &module, INSTANCE_HANDLE * handleId)
 // --------------------------------------------------------------------------
 // UnitySetInterfaces
 static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType);
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Prewarm();
 
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnityInterfaces* unityInterfaces)
 {
@@ -80,6 +83,9 @@ extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnit
 
     // Run OnGraphicsDeviceEvent(initialize) manually on plugin load
     OnGraphicsDeviceEvent(kUnityGfxDeviceEventInitialize);
+
+    // get the first capture's start up work going while the app loads
+    Prewarm();
 }
 
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload()
@@ -93,6 +99,8 @@ extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload()
 
     s_lastPluginHandleIndex = INSTANCE_HANDLE_INVALID;
 
+    Prewarmer::Instance()->Release();
+
     s_unityGraphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
 }
 
@@ -156,6 +164,37 @@ extern "C" UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRen
 
 // --------------------------------------------------------------------------
 // Other function
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Prewarm()
+{
+    // the media device is created on the adapter unity renders with
+    winrt::com_ptr<IDXGIAdapter> dxgiAdapter = nullptr;
+
+    auto resources = std::dynamic_pointer_cast<ID3D11DeviceResource>(s_deviceResource);
+    if (resources != nullptr)
+    {
+        auto dxgiDevice = resources->GetDevice().try_as<IDXGIDevice>();
+        if (dxgiDevice != nullptr)
+        {
+            dxgiDevice->GetAdapter(dxgiAdapter.put());
+        }
+    }
+
+    Prewarmer::Instance()->Start(dxgiAdapter.get());
+}
+
+// latency of video frames from capture to each stage, across all captures
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetFrameLatencyStats(
+    _In_ LatencyStage stage,
+    _Out_ LATENCY_STATS* pStats)
+{
+    return FrameLatency::Instance()->GetStats(stage, pStats);
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ResetFrameLatencyStats()
+{
+    FrameLatency::Instance()->Reset();
+}
+
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseInstance(
     _In_ INSTANCE_HANDLE id)
 {
@@ -168,6 +207,23 @@ extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseInstance(
     }
 }
 
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetCallbackDelivery(
+    _In_ INSTANCE_HANDLE id,
+    _In_ CallbackDelivery delivery)
+{
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto modulePriv = module.as<IModulePriv>();
+        NULL_CHK_HR(modulePriv, E_NOINTERFACE);
+
+        hr = modulePriv->SetCallbackDelivery(delivery);
+    }
+
+    return hr;
+}
+
 
 // Capture
 extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreateCapture(
@@ -248,6 +304,48 @@ extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureTakePhoto(
     return hr;
 }
 
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureTakePhotoBurst(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t width,
+    _In_ uint32_t height,
+    _In_ uint32_t count,
+    _In_ boolean enableMrc)
+{
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.TakePhotoBurst(width, height, count, enableMrc);
+    }
+
+    return hr;
+}
+
+// copies the latest preview frame, its PhotoFrame state is returned rather than raised
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureGrabFrame(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ CAPTURE_STATE* pState)
+{
+    NULL_CHK_HR(pState, E_INVALIDARG);
+
+    ZeroMemory(pState, sizeof(CAPTURE_STATE));
+
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capturePriv = module.as<ICaptureEnginePriv>();
+        NULL_CHK_HR(capturePriv, E_NOINTERFACE);
+
+        hr = capturePriv->GrabFrame(pState);
+    }
+
+    return hr;
+}
+
 extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetCoordinateSystem(
     _In_ INSTANCE_HANDLE id,
     _In_ IUnknown* worldOrigin)
@@ -280,3 +378,208 @@ extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetCoordina
 
     return hr;
 }
+
+// pose of the camera at a QPC time (100ns) of a recent frame, S_FALSE if it is outside the pose history
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureGetCameraToWorld(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int64_t timestamp,
+    _Out_ winrt::Windows::Foundation::Numerics::float4x4* pCameraToWorld)
+{
+    NULL_CHK_HR(pCameraToWorld, E_INVALIDARG);
+
+    *pCameraToWorld = winrt::Windows::Foundation::Numerics::float4x4::identity();
+
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = S_FALSE;
+        if (s_payloadHandler != nullptr && s_payloadHandler.TryGetCameraToWorld(timestamp, *pCameraToWorld))
+        {
+            hr = S_OK;
+        }
+    }
+
+    return hr;
+}
+
+// pose of the camera predicted to a later QPC time (100ns), such as when the frame
+// being rendered will be displayed; S_FALSE if there is no pose to predict from
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CapturePredictCameraToWorld(
+    _In_ INSTANCE_HANDLE id,
+    _In_ int64_t targetTime,
+    _In_ PosePrediction prediction,
+    _Out_ winrt::Windows::Foundation::Numerics::float4x4* pCameraToWorld)
+{
+    NULL_CHK_HR(pCameraToWorld, E_INVALIDARG);
+
+    *pCameraToWorld = winrt::Windows::Foundation::Numerics::float4x4::identity();
+
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = S_FALSE;
+        if (s_payloadHandler != nullptr
+            && s_payloadHandler.TryPredictCameraToWorld(targetTime, prediction == PosePrediction::ConstantAcceleration, *pCameraToWorld))
+        {
+            hr = S_OK;
+        }
+    }
+
+    return hr;
+}
+
+// the camera calibration block, updated in place when the calibration changes; the
+// payload handler owning it is never released so the pointer stays valid
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureGetCameraCalibration(
+    _In_ INSTANCE_HANDLE id,
+    _Outptr_ CAMERA_CALIBRATION const** ppCalibration)
+{
+    NULL_CHK_HR(ppCalibration, E_INVALIDARG);
+
+    *ppCalibration = nullptr;
+
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        if (s_payloadHandler == nullptr)
+        {
+            s_payloadHandler = winrt::CameraCapture::Media::PayloadHandler();
+        }
+
+        auto calibrationPriv = s_payloadHandler.as<ICameraCalibrationPriv>();
+        NULL_CHK_HR(calibrationPriv, E_NOINTERFACE);
+
+        hr = calibrationPriv->GetCameraCalibration(ppCalibration);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetFrameDecimation(
+    _In_ INSTANCE_HANDLE id,
+    _In_ uint32_t frameInterval,
+    _In_ double targetFrameRate)
+{
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.FrameDecimation(frameInterval, targetFrameRate);
+    }
+
+    return hr;
+}
+
+// frames that barely differ from the last unmarked one get FrameFlags::Redundant,
+// a maxLumaDifference of 0 compares only the camera pose. While enabled each frame's
+// pose is located on the payload thread before the frame is delivered, not on the
+// pose worker, which adds the spatial locator's cost to every frame's latency
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetRedundantFrameDetection(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable,
+    _In_ float maxTranslation,
+    _In_ float maxRotationDegrees,
+    _In_ float maxLumaDifference,
+    _In_ uint32_t maxRedundantFrames)
+{
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        if (s_payloadHandler == nullptr)
+        {
+            s_payloadHandler = winrt::CameraCapture::Media::PayloadHandler();
+        }
+
+        s_payloadHandler.SetRedundantFrameDetection(enable, maxTranslation, maxRotationDegrees, maxLumaDifference, maxRedundantFrames);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetTripleBuffering(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable)
+{
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.TripleBuffering(enable);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureSetKeepWarm(
+    _In_ INSTANCE_HANDLE id,
+    _In_ boolean enable,
+    _In_ uint32_t idleTimeoutMs)
+{
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capture = module.as<winrt::CaptureEngine>();
+        NULL_CHK_HR(capture, HRESULT_FROM_WIN32(ERROR_INVALID_INDEX));
+
+        hr = capture.KeepWarm(enable, idleTimeoutMs);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureGetStartupTimings(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ STARTUP_TIMINGS* pTimings)
+{
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capturePriv = module.as<ICaptureEnginePriv>();
+        NULL_CHK_HR(capturePriv, E_NOINTERFACE);
+
+        hr = capturePriv->GetStartupTimings(pTimings);
+    }
+
+    return hr;
+}
+
+extern "C" int32_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CaptureGetTeardownTimings(
+    _In_ INSTANCE_HANDLE id,
+    _Out_ TEARDOWN_TIMINGS* pTimings)
+{
+    winrt::Module module = nullptr;
+    winrt::hresult hr = GetModule(id, module);
+    if (SUCCEEDED(hr))
+    {
+        auto capturePriv = module.as<ICaptureEnginePriv>();
+        NULL_CHK_HR(capturePriv, E_NOINTERFACE);
+
+        hr = capturePriv->GetTeardownTimings(pTimings);
+    }
+
+    return hr;
+}
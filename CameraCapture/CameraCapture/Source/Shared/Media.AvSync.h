@@ -0,0 +1,262 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// Times of one sample in 100ns units. The device time is when the device captured
+// the sample (MFSampleExtension_DeviceTimestamp), the sample time is on the
+// presentation clock the sink runs on.
+struct AvTimestamp
+{
+    int64_t sampleTime;
+    int64_t duration;       // 0 if unknown
+    int64_t deviceTime;
+    bool hasDeviceTime;
+};
+
+// One video frame and the audio blocks that start in its interval
+template <typename T>
+struct AvBundle
+{
+    T video;
+    AvTimestamp videoTime;
+    int64_t intervalDuration;   // the frame's interval, from its start to the next frame's start
+    std::vector<T> audio;       // in presentation order
+    std::vector<AvTimestamp> audioTimes;
+    bool isComplete;            // false if released before the audio reached the end of the interval
+};
+
+// Pairs video frames with the audio captured during them. Each frame covers the
+// interval up to the next frame and is held in a small reorder buffer until the
+// audio stream has been delivered past the end of that interval, then released
+// with every audio block that starts inside it. Audio that ends before the oldest
+// frame waiting is dropped, it belongs to a frame that was already released.
+//
+// Pairing runs on device timestamps as long as every sample of both streams has
+// one, otherwise on sample times. Not thread safe, push from the thread that
+// delivers the payloads.
+template <typename T>
+class AvSynchronizer
+{
+public:
+    AvSynchronizer(size_t maxPendingVideo = 4, size_t maxPendingAudio = 256)
+        : m_maxPendingVideo(maxPendingVideo > 0 ? maxPendingVideo : 1)
+        , m_maxPendingAudio(maxPendingAudio > 0 ? maxPendingAudio : 1)
+    {
+        Reset(true);
+    }
+
+    // starts a new session, without audio frames are released as soon as their interval is known
+    void Reset(bool expectAudio)
+    {
+        m_expectAudio = expectAudio;
+        m_useDeviceTime = true;
+        m_hasAudioEnd = false;
+        m_audioEndSampleTime = 0;
+        m_audioEndDeviceTime = 0;
+        m_droppedAudioCount = 0;
+        m_video.clear();
+        m_audio.clear();
+    }
+
+    bool IsAudioExpected() const { return m_expectAudio; }
+
+    // audio blocks that could not be paired with a frame since the last Reset
+    uint64_t DroppedAudioCount() const { return m_droppedAudioCount; }
+
+    void PushVideo(T const& video, AvTimestamp const& time)
+    {
+        UpdateClock(time);
+
+        Insert(m_video, Entry{ video, time });
+    }
+
+    void PushAudio(T const& audio, AvTimestamp const& time)
+    {
+        UpdateClock(time);
+
+        auto sampleEnd = time.sampleTime + time.duration;
+        auto deviceEnd = time.deviceTime + time.duration;
+        if (!m_hasAudioEnd || sampleEnd > m_audioEndSampleTime)
+        {
+            m_audioEndSampleTime = sampleEnd;
+        }
+        if (!m_hasAudioEnd || deviceEnd > m_audioEndDeviceTime)
+        {
+            m_audioEndDeviceTime = deviceEnd;
+        }
+        m_hasAudioEnd = true;
+
+        if (m_audio.size() >= m_maxPendingAudio)
+        {
+            m_audio.pop_front();
+            ++m_droppedAudioCount;
+        }
+
+        Insert(m_audio, Entry{ audio, time });
+    }
+
+    // hands every bundle that is ready to func, oldest first
+    template <typename Func>
+    void Drain(Func&& func)
+    {
+        while (!m_video.empty())
+        {
+            int64_t end = 0;
+            auto hasEnd = IntervalEnd(end);
+
+            if (hasEnd && (!m_expectAudio || (m_hasAudioEnd && AudioEnd() >= end)))
+            {
+                Release(end, true, func);
+            }
+            else if (m_video.size() > m_maxPendingVideo)
+            {
+                // the audio is too far behind, don't hold video back any longer
+                Release(hasEnd ? end : Clock(m_video.front().time), false, func);
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    // releases every frame still waiting, with whatever audio has arrived for it
+    template <typename Func>
+    void Flush(Func&& func)
+    {
+        while (!m_video.empty())
+        {
+            int64_t end = 0;
+            if (!IntervalEnd(end))
+            {
+                end = m_hasAudioEnd && AudioEnd() > Clock(m_video.front().time) ? AudioEnd() : Clock(m_video.front().time);
+            }
+
+            auto isComplete = !m_expectAudio || (m_hasAudioEnd && AudioEnd() >= end);
+
+            Release(end, isComplete, func);
+        }
+
+        m_audio.clear();
+    }
+
+private:
+    struct Entry
+    {
+        T item;
+        AvTimestamp time;
+    };
+
+    int64_t Clock(AvTimestamp const& time) const
+    {
+        return m_useDeviceTime ? time.deviceTime : time.sampleTime;
+    }
+
+    int64_t AudioEnd() const
+    {
+        return m_useDeviceTime ? m_audioEndDeviceTime : m_audioEndSampleTime;
+    }
+
+    // one sample without a device time switches the session to sample times for good
+    void UpdateClock(AvTimestamp const& time)
+    {
+        if (!time.hasDeviceTime)
+        {
+            m_useDeviceTime = false;
+        }
+    }
+
+    // streams are delivered in order, only a late sample walks back through the buffer
+    void Insert(std::deque<Entry>& entries, Entry&& entry)
+    {
+        auto it = entries.end();
+        while (it != entries.begin() && Clock(std::prev(it)->time) > Clock(entry.time))
+        {
+            --it;
+        }
+
+        entries.insert(it, std::move(entry));
+    }
+
+    // the oldest frame's interval ends where the next frame starts
+    bool IntervalEnd(int64_t& end) const
+    {
+        if (m_video.size() > 1)
+        {
+            end = Clock(m_video[1].time);
+
+            return true;
+        }
+
+        auto const& time = m_video.front().time;
+        if (time.duration > 0)
+        {
+            end = Clock(time) + time.duration;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    template <typename Func>
+    void Release(int64_t end, bool isComplete, Func& func)
+    {
+        auto entry = std::move(m_video.front());
+        m_video.pop_front();
+
+        auto start = Clock(entry.time);
+
+        // T may not be default constructible
+        AvBundle<T> bundle{ std::move(entry.item), entry.time, end > start ? end - start : 0, {}, {}, isComplete };
+
+        while (!m_audio.empty())
+        {
+            auto const& audio = m_audio.front();
+
+            auto audioStart = Clock(audio.time);
+            if (audioStart >= end && end > start)
+            {
+                break;
+            }
+
+            if (audioStart < start && audioStart + audio.time.duration <= start)
+            {
+                ++m_droppedAudioCount;
+            }
+            else if (end > start)
+            {
+                bundle.audio.push_back(std::move(m_audio.front().item));
+                bundle.audioTimes.push_back(audio.time);
+            }
+            else
+            {
+                break;
+            }
+
+            m_audio.pop_front();
+        }
+
+        func(std::move(bundle));
+    }
+
+private:
+    size_t m_maxPendingVideo;
+    size_t m_maxPendingAudio;
+    bool m_expectAudio;
+    bool m_useDeviceTime;
+    bool m_hasAudioEnd;
+    int64_t m_audioEndSampleTime;
+    int64_t m_audioEndDeviceTime;
+    uint64_t m_droppedAudioCount;
+    std::deque<Entry> m_video;
+    std::deque<Entry> m_audio;
+};
@@ -0,0 +1,418 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// built without the precompiled header, which pulls in the Windows headers
+#include "Media.BatchMath.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(BATCHMATH_NO_SIMD)
+// scalar path only
+#elif defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define BATCHMATH_SSE
+#include <emmintrin.h>
+#elif defined(_M_ARM64)
+#define BATCHMATH_NEON
+#include <arm64_neon.h>
+#elif defined(_M_ARM) || defined(__ARM_NEON)
+#define BATCHMATH_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    // rotation part of a quaternion as a matrix, in the same convention as
+    // make_float4x4_from_quaternion
+    void QuaternionToMatrix(float const* q, float* m)
+    {
+        auto x = q[0];
+        auto y = q[1];
+        auto z = q[2];
+        auto w = q[3];
+
+        m[0] = 1.0f - 2.0f * (y * y + z * z);
+        m[1] = 2.0f * (x * y + z * w);
+        m[2] = 2.0f * (x * z - y * w);
+        m[3] = 0.0f;
+
+        m[4] = 2.0f * (x * y - z * w);
+        m[5] = 1.0f - 2.0f * (z * z + x * x);
+        m[6] = 2.0f * (y * z + x * w);
+        m[7] = 0.0f;
+
+        m[8] = 2.0f * (x * z + y * w);
+        m[9] = 2.0f * (y * z - x * w);
+        m[10] = 1.0f - 2.0f * (y * y + x * x);
+        m[11] = 0.0f;
+
+        m[12] = 0.0f;
+        m[13] = 0.0f;
+        m[14] = 0.0f;
+        m[15] = 1.0f;
+    }
+}
+
+void BatchMath::MultiplyMatrices(
+    float const* a,
+    float const* b,
+    float* out,
+    size_t count)
+{
+    for (size_t i = 0; i < count; ++i, a += 16, b += 16, out += 16)
+    {
+#if defined(BATCHMATH_SSE)
+        auto b0 = _mm_loadu_ps(b);
+        auto b1 = _mm_loadu_ps(b + 4);
+        auto b2 = _mm_loadu_ps(b + 8);
+        auto b3 = _mm_loadu_ps(b + 12);
+
+        __m128 rows[4];
+        for (size_t row = 0; row < 4; ++row)
+        {
+            auto r = _mm_loadu_ps(a + row * 4);
+
+            auto result = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+            result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+            result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+            rows[row] = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+        }
+
+        for (size_t row = 0; row < 4; ++row)
+        {
+            _mm_storeu_ps(out + row * 4, rows[row]);
+        }
+#elif defined(BATCHMATH_NEON)
+        auto b0 = vld1q_f32(b);
+        auto b1 = vld1q_f32(b + 4);
+        auto b2 = vld1q_f32(b + 8);
+        auto b3 = vld1q_f32(b + 12);
+
+        float32x4_t rows[4];
+        for (size_t row = 0; row < 4; ++row)
+        {
+            auto r = vld1q_f32(a + row * 4);
+
+            auto result = vmulq_n_f32(b0, vgetq_lane_f32(r, 0));
+            result = vmlaq_n_f32(result, b1, vgetq_lane_f32(r, 1));
+            result = vmlaq_n_f32(result, b2, vgetq_lane_f32(r, 2));
+            rows[row] = vmlaq_n_f32(result, b3, vgetq_lane_f32(r, 3));
+        }
+
+        for (size_t row = 0; row < 4; ++row)
+        {
+            vst1q_f32(out + row * 4, rows[row]);
+        }
+#else
+        float result[16];
+        for (size_t row = 0; row < 4; ++row)
+        {
+            for (size_t column = 0; column < 4; ++column)
+            {
+                result[row * 4 + column] =
+                    a[row * 4] * b[column]
+                    + a[row * 4 + 1] * b[4 + column]
+                    + a[row * 4 + 2] * b[8 + column]
+                    + a[row * 4 + 3] * b[12 + column];
+            }
+        }
+
+        memcpy(out, result, sizeof(result));
+#endif
+    }
+}
+
+bool BatchMath::InvertMatrix(
+    float const* m,
+    float* out)
+{
+    // cofactors from the 2x2 determinants of the top and bottom row pairs
+    auto s0 = m[0] * m[5] - m[4] * m[1];
+    auto s1 = m[0] * m[6] - m[4] * m[2];
+    auto s2 = m[0] * m[7] - m[4] * m[3];
+    auto s3 = m[1] * m[6] - m[5] * m[2];
+    auto s4 = m[1] * m[7] - m[5] * m[3];
+    auto s5 = m[2] * m[7] - m[6] * m[3];
+
+    auto c5 = m[10] * m[15] - m[14] * m[11];
+    auto c4 = m[9] * m[15] - m[13] * m[11];
+    auto c3 = m[9] * m[14] - m[13] * m[10];
+    auto c2 = m[8] * m[15] - m[12] * m[11];
+    auto c1 = m[8] * m[14] - m[12] * m[10];
+    auto c0 = m[8] * m[13] - m[12] * m[9];
+
+    auto determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (determinant == 0.0f || !std::isfinite(determinant))
+    {
+        return false;
+    }
+
+    auto scale = 1.0f / determinant;
+
+    float result[16] =
+    {
+        (m[5] * c5 - m[6] * c4 + m[7] * c3) * scale,
+        (-m[1] * c5 + m[2] * c4 - m[3] * c3) * scale,
+        (m[13] * s5 - m[14] * s4 + m[15] * s3) * scale,
+        (-m[9] * s5 + m[10] * s4 - m[11] * s3) * scale,
+
+        (-m[4] * c5 + m[6] * c2 - m[7] * c1) * scale,
+        (m[0] * c5 - m[2] * c2 + m[3] * c1) * scale,
+        (-m[12] * s5 + m[14] * s2 - m[15] * s1) * scale,
+        (m[8] * s5 - m[10] * s2 + m[11] * s1) * scale,
+
+        (m[4] * c4 - m[5] * c2 + m[7] * c0) * scale,
+        (-m[0] * c4 + m[1] * c2 - m[3] * c0) * scale,
+        (m[12] * s4 - m[13] * s2 + m[15] * s0) * scale,
+        (-m[8] * s4 + m[9] * s2 - m[11] * s0) * scale,
+
+        (-m[4] * c3 + m[5] * c1 - m[6] * c0) * scale,
+        (m[0] * c3 - m[1] * c1 + m[2] * c0) * scale,
+        (-m[12] * s3 + m[13] * s1 - m[14] * s0) * scale,
+        (m[8] * s3 - m[9] * s1 + m[10] * s0) * scale,
+    };
+
+    memcpy(out, result, sizeof(result));
+
+    return true;
+}
+
+void BatchMath::InvertRigidMatrices(
+    float const* m,
+    float* out,
+    size_t count)
+{
+    // the rotation is transposed and the translation rotated back and negated
+    for (size_t i = 0; i < count; ++i, m += 16, out += 16)
+    {
+#if defined(BATCHMATH_SSE)
+        auto r0 = _mm_loadu_ps(m);
+        auto r1 = _mm_loadu_ps(m + 4);
+        auto r2 = _mm_loadu_ps(m + 8);
+        auto t = _mm_loadu_ps(m + 12);
+        auto r3 = _mm_setzero_ps();
+
+        // the last column of a rigid transform is 0, 0, 0, 1; after the transpose
+        // the zero row leaves the rotation rows with w = 0
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        auto translation = _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+        translation = _mm_add_ps(translation, _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+        translation = _mm_add_ps(translation, _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+        translation = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), translation);
+
+        _mm_storeu_ps(out, r0);
+        _mm_storeu_ps(out + 4, r1);
+        _mm_storeu_ps(out + 8, r2);
+        _mm_storeu_ps(out + 12, translation);
+#elif defined(BATCHMATH_NEON)
+        auto t01 = vtrnq_f32(vld1q_f32(m), vld1q_f32(m + 4));
+        auto t23 = vtrnq_f32(vld1q_f32(m + 8), vdupq_n_f32(0.0f));
+        auto t = vld1q_f32(m + 12);
+
+        auto r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+        auto r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+        auto r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+
+        auto translation = vmulq_n_f32(r0, vgetq_lane_f32(t, 0));
+        translation = vmlaq_n_f32(translation, r1, vgetq_lane_f32(t, 1));
+        translation = vmlaq_n_f32(translation, r2, vgetq_lane_f32(t, 2));
+        translation = vsubq_f32(vsetq_lane_f32(1.0f, vdupq_n_f32(0.0f), 3), translation);
+
+        vst1q_f32(out, r0);
+        vst1q_f32(out + 4, r1);
+        vst1q_f32(out + 8, r2);
+        vst1q_f32(out + 12, translation);
+#else
+        float result[16] =
+        {
+            m[0], m[4], m[8], 0.0f,
+            m[1], m[5], m[9], 0.0f,
+            m[2], m[6], m[10], 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f,
+        };
+
+        for (size_t column = 0; column < 3; ++column)
+        {
+            result[12 + column] = -(m[12] * result[column] + m[13] * result[4 + column] + m[14] * result[8 + column]);
+        }
+
+        memcpy(out, result, sizeof(result));
+#endif
+    }
+}
+
+void BatchMath::TransformPoints(
+    float const* m,
+    float const* points,
+    float* out,
+    size_t count)
+{
+#if defined(BATCHMATH_SSE)
+    auto r0 = _mm_loadu_ps(m);
+    auto r1 = _mm_loadu_ps(m + 4);
+    auto r2 = _mm_loadu_ps(m + 8);
+    auto r3 = _mm_loadu_ps(m + 12);
+
+    for (size_t i = 0; i < count; ++i, points += 3, out += 3)
+    {
+        auto result = _mm_add_ps(r3, _mm_mul_ps(_mm_set1_ps(points[0]), r0));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(points[1]), r1));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(points[2]), r2));
+
+        // three floats, the next point may follow
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), result);
+        _mm_store_ss(out + 2, _mm_movehl_ps(result, result));
+    }
+#elif defined(BATCHMATH_NEON)
+    auto r0 = vld1q_f32(m);
+    auto r1 = vld1q_f32(m + 4);
+    auto r2 = vld1q_f32(m + 8);
+    auto r3 = vld1q_f32(m + 12);
+
+    for (size_t i = 0; i < count; ++i, points += 3, out += 3)
+    {
+        auto result = vmlaq_n_f32(r3, r0, points[0]);
+        result = vmlaq_n_f32(result, r1, points[1]);
+        result = vmlaq_n_f32(result, r2, points[2]);
+
+        vst1_f32(out, vget_low_f32(result));
+        vst1q_lane_f32(out + 2, result, 2);
+    }
+#else
+    for (size_t i = 0; i < count; ++i, points += 3, out += 3)
+    {
+        auto x = points[0];
+        auto y = points[1];
+        auto z = points[2];
+
+        out[0] = x * m[0] + y * m[4] + z * m[8] + m[12];
+        out[1] = x * m[1] + y * m[5] + z * m[9] + m[13];
+        out[2] = x * m[2] + y * m[6] + z * m[10] + m[14];
+    }
+#endif
+}
+
+void BatchMath::TransformCoordinates(
+    float const* m,
+    float const* points,
+    float* out,
+    size_t count)
+{
+#if defined(BATCHMATH_SSE)
+    auto r0 = _mm_loadu_ps(m);
+    auto r1 = _mm_loadu_ps(m + 4);
+    auto r2 = _mm_loadu_ps(m + 8);
+    auto r3 = _mm_loadu_ps(m + 12);
+
+    for (size_t i = 0; i < count; ++i, points += 3, out += 3)
+    {
+        auto result = _mm_add_ps(r3, _mm_mul_ps(_mm_set1_ps(points[0]), r0));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(points[1]), r1));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(points[2]), r2));
+        result = _mm_div_ps(result, _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 3, 3, 3)));
+
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), result);
+        _mm_store_ss(out + 2, _mm_movehl_ps(result, result));
+    }
+#elif defined(BATCHMATH_NEON)
+    auto r0 = vld1q_f32(m);
+    auto r1 = vld1q_f32(m + 4);
+    auto r2 = vld1q_f32(m + 8);
+    auto r3 = vld1q_f32(m + 12);
+
+    for (size_t i = 0; i < count; ++i, points += 3, out += 3)
+    {
+        auto result = vmlaq_n_f32(r3, r0, points[0]);
+        result = vmlaq_n_f32(result, r1, points[1]);
+        result = vmlaq_n_f32(result, r2, points[2]);
+
+        // 32 bit ARM has no vector divide
+        result = vmulq_n_f32(result, 1.0f / vgetq_lane_f32(result, 3));
+
+        vst1_f32(out, vget_low_f32(result));
+        vst1q_lane_f32(out + 2, result, 2);
+    }
+#else
+    for (size_t i = 0; i < count; ++i, points += 3, out += 3)
+    {
+        auto x = points[0];
+        auto y = points[1];
+        auto z = points[2];
+
+        auto w = x * m[3] + y * m[7] + z * m[11] + m[15];
+
+        out[0] = (x * m[0] + y * m[4] + z * m[8] + m[12]) / w;
+        out[1] = (x * m[1] + y * m[5] + z * m[9] + m[13]) / w;
+        out[2] = (x * m[2] + y * m[6] + z * m[10] + m[14]) / w;
+    }
+#endif
+}
+
+void BatchMath::MultiplyQuaternions(
+    float const* a,
+    float const* b,
+    float* out,
+    size_t count)
+{
+    // a * b = a.w * b + a.x * (w, -z, y, -x) + a.y * (z, w, -x, -y) + a.z * (-y, x, w, -z) of b
+    for (size_t i = 0; i < count; ++i, a += 4, b += 4, out += 4)
+    {
+#if defined(BATCHMATH_SSE)
+        auto qa = _mm_loadu_ps(a);
+        auto qb = _mm_loadu_ps(b);
+
+        auto result = _mm_mul_ps(_mm_shuffle_ps(qa, qa, _MM_SHUFFLE(3, 3, 3, 3)), qb);
+        result = _mm_add_ps(result, _mm_mul_ps(
+            _mm_shuffle_ps(qa, qa, _MM_SHUFFLE(0, 0, 0, 0)),
+            _mm_mul_ps(_mm_shuffle_ps(qb, qb, _MM_SHUFFLE(0, 1, 2, 3)), _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f))));
+        result = _mm_add_ps(result, _mm_mul_ps(
+            _mm_shuffle_ps(qa, qa, _MM_SHUFFLE(1, 1, 1, 1)),
+            _mm_mul_ps(_mm_shuffle_ps(qb, qb, _MM_SHUFFLE(1, 0, 3, 2)), _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f))));
+        result = _mm_add_ps(result, _mm_mul_ps(
+            _mm_shuffle_ps(qa, qa, _MM_SHUFFLE(2, 2, 2, 2)),
+            _mm_mul_ps(_mm_shuffle_ps(qb, qb, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f))));
+
+        _mm_storeu_ps(out, result);
+#elif defined(BATCHMATH_NEON)
+        static float const xSigns[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+        static float const ySigns[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
+        static float const zSigns[4] = { -1.0f, 1.0f, 1.0f, -1.0f };
+
+        auto qa = vld1q_f32(a);
+        auto qb = vld1q_f32(b);
+
+        auto yxwz = vrev64q_f32(qb);
+        auto wzyx = vcombine_f32(vget_high_f32(yxwz), vget_low_f32(yxwz));
+        auto zwxy = vcombine_f32(vget_high_f32(qb), vget_low_f32(qb));
+
+        auto result = vmulq_n_f32(qb, vgetq_lane_f32(qa, 3));
+        result = vmlaq_n_f32(result, vmulq_f32(wzyx, vld1q_f32(xSigns)), vgetq_lane_f32(qa, 0));
+        result = vmlaq_n_f32(result, vmulq_f32(zwxy, vld1q_f32(ySigns)), vgetq_lane_f32(qa, 1));
+        result = vmlaq_n_f32(result, vmulq_f32(yxwz, vld1q_f32(zSigns)), vgetq_lane_f32(qa, 2));
+
+        vst1q_f32(out, result);
+#else
+        auto ax = a[0], ay = a[1], az = a[2], aw = a[3];
+        auto bx = b[0], by = b[1], bz = b[2], bw = b[3];
+
+        out[0] = aw * bx + ax * bw + ay * bz - az * by;
+        out[1] = aw * by - ax * bz + ay * bw + az * bx;
+        out[2] = aw * bz + ax * by - ay * bx + az * bw;
+        out[3] = aw * bw - ax * bx - ay * by - az * bz;
+#endif
+    }
+}
+
+void BatchMath::RotatePoints(
+    float const* q,
+    float const* points,
+    float* out,
+    size_t count)
+{
+    // one conversion, then every point is a matrix transform
+    float rotation[16];
+    QuaternionToMatrix(q, rotation);
+
+    TransformPoints(rotation, points, out, count);
+}
@@ -0,0 +1,66 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstddef>
+
+// Batches of matrix, point and quaternion math on plain float arrays, vectorized
+// with SSE on x86/x64 and NEON on ARM/ARM64, with a scalar fallback elsewhere.
+//
+// Matrices are 16 floats, row major, transforming row vectors (v * M) with the
+// translation in the last row; the layout of Windows::Foundation::Numerics::float4x4,
+// so &matrix.m11 can be passed directly. Points are x, y, z triples and quaternions
+// x, y, z, w. Outputs may alias their inputs.
+//
+// Has no platform dependencies so the vector paths can be checked against the
+// scalar results anywhere; defining BATCHMATH_NO_SIMD builds the scalar path alone.
+namespace BatchMath
+{
+    // out[i] = a[i] * b[i]
+    void MultiplyMatrices(
+        float const* a,
+        float const* b,
+        float* out,
+        size_t count);
+
+    // general inverse, false and out left untouched if m is singular
+    bool InvertMatrix(
+        float const* m,
+        float* out);
+
+    // inverse of matrices made only of a rotation and a translation, such as
+    // camera to world transforms, without the cost of the general inverse
+    void InvertRigidMatrices(
+        float const* m,
+        float* out,
+        size_t count);
+
+    // points * m with w = 1, the last column of m is ignored
+    void TransformPoints(
+        float const* m,
+        float const* points,
+        float* out,
+        size_t count);
+
+    // points * m with w = 1, divided by the resulting w; for points through a projection
+    void TransformCoordinates(
+        float const* m,
+        float const* points,
+        float* out,
+        size_t count);
+
+    // out[i] = a[i] * b[i], the product of Windows::Foundation::Numerics::quaternion
+    void MultiplyQuaternions(
+        float const* a,
+        float const* b,
+        float* out,
+        size_t count);
+
+    // rotates points by the unit quaternion q
+    void RotatePoints(
+        float const* q,
+        float const* points,
+        float* out,
+        size_t count);
+}
@@ -522,3 +522,16 @@ void Sink::QueuePayload(CameraCapture::Media::Payload const& payload)
         m_payloadHandler.QueuePayload(payload);
     }
 }
+
+bool Sink::ShouldQueueSample(guid const& majorType, int64_t sampleTime)
+{
+    auto guard = m_cs.Guard();
+
+    // without a handler the payload would be discarded anyway
+    if (m_payloadHandler == nullptr)
+    {
+        return false;
+    }
+
+    return m_payloadHandler.ShouldQueueSample(majorType, sampleTime);
+}
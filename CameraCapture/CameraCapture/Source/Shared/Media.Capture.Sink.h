@@ -27,6 +27,7 @@ namespace winrt::CameraCapture::Media::Capture::implementation
         void QueueMetadata(Windows::Media::MediaProperties::MediaPropertySet const& metaData);
         void QueueEncodingProperties(Windows::Media::MediaProperties::IMediaEncodingProperties const& mediaDescription);
         void QueuePayload(CameraCapture::Media::Payload const& payload);
+        bool ShouldQueueSample(guid const& majorType, int64_t sampleTime);
 
         // IMediaExtension
         void SetProperties(Windows::Foundation::Collections::IPropertySet const& configuration);
@@ -7,6 +7,7 @@
 #include "Media.Payload.h"
 #include "Media.PayloadHandler.h"
 #include "Media.Functions.h"
+#include "Media.FrameLatency.h"
 
 #include <winrt/windows.media.mediaproperties.h>
 
@@ -115,6 +116,7 @@ HRESULT StreamSink::Flush()
     m_sampleRequests = 0;
     m_lastTimestamp = -1;
     m_lastDecodeTime = -1;
+    m_timestampRegularizer.Reset();
 
     auto propSet = Windows::Media::MediaProperties::MediaPropertySet();
     propSet.Insert(MF_PAYLOAD_FLUSH, box_value<uint32_t>(1));
@@ -143,8 +145,19 @@ HRESULT StreamSink::ProcessSample(
 
     hr = ShouldDropSample(pSample, &shouldDrop);
 
+    // decimate before a payload is created for the sample
+    if (!shouldDrop && !m_parentSink.ShouldQueueSample(m_guidMajorType, m_lastTimestamp))
+    {
+        goto done;
+    }
+
     if (!shouldDrop)
     {
+        if (MFMediaType_Video == m_guidMajorType)
+        {
+            FrameLatency::Instance()->Record(LatencyStage::SinkArrival, pSample);
+        }
+
         if (m_setDiscontinuity)
         {
             IFG(pSample->SetUINT32(MFSampleExtension_Discontinuity, TRUE), done);
@@ -535,6 +548,26 @@ HRESULT StreamSink::ShouldDropSample(
 
     if (FAILED(pSample->GetUINT64(MFSampleExtension_DecodeTimestamp, (QWORD*)&decodeTime)))
     {
+        // move video onto the recovered frame clock, jitter no longer pushes a
+        // timestamp behind the previous one and gets the frame dropped
+        if (MFMediaType_Video == m_guidMajorType)
+        {
+            auto regularized = m_timestampRegularizer.Process(timestamp);
+            if (regularized.isCorrected)
+            {
+                IFG(pSample->SetSampleTime(regularized.timestamp), done);
+
+                timestamp = regularized.timestamp;
+            }
+
+            if (regularized.isDiscontinuity && m_lastDecodeTime >= 0)
+            {
+                Log(L"video timestamps are discontinuous, ts=%I64d m_lastDecodeTime=%I64d\n", timestamp, m_lastDecodeTime);
+
+                m_setDiscontinuity = true;
+            }
+        }
+
         // No MFSampleExtension_DecodeTimestamp means DTS eaqual to PTS, using timestamp
         if (timestamp <= m_lastDecodeTime)
         {
@@ -9,6 +9,8 @@
 #include <mfidl.h>
 #include <mferror.h>
 
+#include "Media.TimestampRegularizer.h"
+
 #define MAX_SAMPLE_REQUESTS 2
 
 namespace winrt::CameraCapture::Media::Capture::implementation
@@ -141,6 +143,7 @@ namespace winrt::CameraCapture::Media::Capture::implementation
         uint8_t m_sampleRequests;
         LONGLONG m_lastTimestamp;
         LONGLONG m_lastDecodeTime;
+        TimestampRegularizer m_timestampRegularizer; // video only
 
         static const uint8_t m_cMaxSampleRequests = MAX_SAMPLE_REQUESTS;
     };
@@ -0,0 +1,419 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "Media.DeviceCatalog.h"
+#include "Media.Functions.h"
+
+using namespace winrt;
+using namespace Windows::Foundation;
+using namespace Windows::Foundation::Collections;
+using namespace Windows::Devices::Enumeration;
+using namespace Windows::Media::Capture;
+using namespace Windows::Media::Devices;
+using namespace Windows::Media::MediaProperties;
+
+std::shared_ptr<DeviceCatalog> DeviceCatalog::Instance()
+{
+    static std::shared_ptr<DeviceCatalog> s_instance = std::make_shared<DeviceCatalog>();
+
+    return s_instance;
+}
+
+DeviceCatalog::DeviceCatalog()
+    : m_videoDevice(nullptr)
+    , m_audioDevice(nullptr)
+{
+}
+
+DeviceCatalog::~DeviceCatalog()
+{
+    for (auto watch : { &m_videoWatch, &m_audioWatch })
+    {
+        watch->addedRevoker.revoke();
+        watch->removedRevoker.revoke();
+        watch->updatedRevoker.revoke();
+        watch->completedRevoker.revoke();
+
+        if (watch->watcher != nullptr)
+        {
+            auto status = watch->watcher.Status();
+            if (status == DeviceWatcherStatus::Started || status == DeviceWatcherStatus::EnumerationCompleted)
+            {
+                watch->watcher.Stop();
+            }
+
+            watch->watcher = nullptr;
+        }
+    }
+}
+
+_Use_decl_annotations_
+IAsyncOperation<DeviceInformation> DeviceCatalog::GetFirstDeviceAsync(
+    DeviceClass const deviceClass)
+{
+    // only capture devices are cached
+    if (deviceClass != DeviceClass::VideoCapture && deviceClass != DeviceClass::AudioCapture)
+    {
+        co_return co_await ::GetFirstDeviceAsync(deviceClass);
+    }
+
+    auto strong = shared_from_this();
+
+    DeviceInformation deviceInfo = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        deviceInfo = deviceClass == DeviceClass::VideoCapture ? m_videoDevice : m_audioDevice;
+    }
+
+    if (deviceInfo != nullptr)
+    {
+        co_return deviceInfo;
+    }
+
+    deviceInfo = co_await ::GetFirstDeviceAsync(deviceClass);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (deviceClass == DeviceClass::VideoCapture)
+        {
+            m_videoDevice = deviceInfo;
+
+            StartWatching(deviceClass, m_videoWatch);
+        }
+        else
+        {
+            m_audioDevice = deviceInfo;
+
+            StartWatching(deviceClass, m_audioWatch);
+        }
+    }
+
+    co_return deviceInfo;
+}
+
+_Use_decl_annotations_
+bool DeviceCatalog::IsVideoProfileSupported(
+    hstring const& deviceId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto const& entry : m_profileSupport)
+    {
+        if (entry.first == deviceId)
+        {
+            return entry.second;
+        }
+    }
+
+    auto isSupported = MediaCapture::IsVideoProfileSupported(deviceId);
+
+    m_profileSupport.emplace_back(deviceId, isSupported);
+
+    return isSupported;
+}
+
+_Use_decl_annotations_
+bool DeviceCatalog::FindVideoProfile(
+    hstring const& deviceId,
+    KnownVideoProfile const knownProfile,
+    MediaStreamType const streamType,
+    uint32_t width,
+    uint32_t height,
+    double frameRate,
+    hstring const& subType,
+    MediaCaptureVideoProfile& profile,
+    MediaCaptureVideoProfileMediaDescription& description,
+    double& score)
+{
+    profile = nullptr;
+    description = nullptr;
+    score = 0.0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto const& table = GetProfileTable(deviceId, knownProfile);
+
+    auto isPreview = streamType == MediaStreamType::VideoPreview;
+    auto const& formats = isPreview ? table.previewFormats : table.recordFormats;
+    auto const& descriptions = isPreview ? table.previewDescriptions : table.recordDescriptions;
+
+    auto format = SelectFormat(formats, table.subTypes, width, height, frameRate, subType, score);
+    if (format == nullptr)
+    {
+        return false;
+    }
+
+    profile = table.profiles[format->itemIndex];
+    description = descriptions[format->itemIndex][format->detailIndex];
+
+    return true;
+}
+
+_Use_decl_annotations_
+IMediaEncodingProperties DeviceCatalog::FindStreamProperties(
+    VideoDeviceController const& videoDeviceController,
+    MediaStreamType const streamType,
+    uint32_t width,
+    uint32_t height,
+    double frameRate,
+    hstring const& subType)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto const& table = GetStreamTable(videoDeviceController, streamType);
+
+    double score = 0.0;
+
+    auto format = SelectFormat(table.formats, table.subTypes, width, height, frameRate, subType, score);
+    if (format == nullptr)
+    {
+        return nullptr;
+    }
+
+    return table.properties[format->itemIndex];
+}
+
+void DeviceCatalog::Invalidate()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Log(L"capture devices changed, dropping cached capabilities\n");
+
+    m_videoDevice = nullptr;
+    m_audioDevice = nullptr;
+    m_profileSupport.clear();
+    m_profileTables.clear();
+    m_streamTables.clear();
+}
+
+_Use_decl_annotations_
+DeviceCatalog::ProfileTable const& DeviceCatalog::GetProfileTable(
+    hstring const& deviceId,
+    KnownVideoProfile const knownProfile)
+{
+    for (auto const& table : m_profileTables)
+    {
+        if (table.deviceId == deviceId && table.knownProfile == knownProfile)
+        {
+            return table;
+        }
+    }
+
+    ProfileTable table{};
+    table.deviceId = deviceId;
+    table.knownProfile = knownProfile;
+
+    auto addDescriptions = [&table](
+        IVectorView<MediaCaptureVideoProfileMediaDescription> const& source,
+        std::vector<std::vector<MediaCaptureVideoProfileMediaDescription>>& descriptions,
+        std::vector<FormatEntry>& formats)
+    {
+        auto itemIndex = static_cast<uint16_t>(descriptions.size());
+
+        descriptions.emplace_back();
+
+        for (auto const& desc : source)
+        {
+            Log(L"\tFormat: %s: %i x %i @ %f fps\n",
+                desc.Subtype().c_str(),
+                desc.Width(),
+                desc.Height(),
+                desc.FrameRate());
+
+            FormatEntry format{};
+            format.mode.width = desc.Width();
+            format.mode.height = desc.Height();
+            format.mode.frameRate = FrameRate::FromDouble(desc.FrameRate());
+            format.mode.subTypeId = SubTypeIndex(table.subTypes, desc.Subtype());
+            format.itemIndex = itemIndex;
+            format.detailIndex = static_cast<uint16_t>(descriptions.back().size());
+
+            descriptions.back().push_back(desc);
+            formats.push_back(format);
+        }
+    };
+
+    setlocale(LC_ALL, "");
+
+    Log(L"Known video profiles for %s\n", deviceId.c_str());
+
+    auto profiles = MediaCapture::FindKnownVideoProfiles(deviceId, knownProfile);
+    for (auto const& profile : profiles)
+    {
+        table.profiles.push_back(profile);
+
+        addDescriptions(profile.SupportedPreviewMediaDescription(), table.previewDescriptions, table.previewFormats);
+        addDescriptions(profile.SupportedRecordMediaDescription(), table.recordDescriptions, table.recordFormats);
+    }
+
+    m_profileTables.push_back(std::move(table));
+
+    return m_profileTables.back();
+}
+
+_Use_decl_annotations_
+DeviceCatalog::StreamTable const& DeviceCatalog::GetStreamTable(
+    VideoDeviceController const& videoDeviceController,
+    MediaStreamType const streamType)
+{
+    auto deviceId = videoDeviceController.Id();
+
+    for (auto const& table : m_streamTables)
+    {
+        if (table.deviceId == deviceId && table.streamType == streamType)
+        {
+            return table;
+        }
+    }
+
+    StreamTable table{};
+    table.deviceId = deviceId;
+    table.streamType = streamType;
+
+    auto properties = videoDeviceController.GetAvailableMediaStreamProperties(streamType);
+
+    Log(L"Total available MediaStreamProperties for %s: %i\n", deviceId.c_str(), properties.Size());
+
+    setlocale(LC_ALL, "");
+
+    for (auto const& prop : properties)
+    {
+        // validate it is video
+        auto videoProperty = prop.try_as<IVideoEncodingProperties>();
+        if (prop.Type() != L"Video" || videoProperty == nullptr)
+        {
+            continue;
+        }
+
+        auto frameRate = videoProperty.FrameRate();
+
+        Log(L"\tFormat: %s: %i x %i @ %d/%d fps\n",
+            prop.Subtype().c_str(),
+            videoProperty.Width(),
+            videoProperty.Height(),
+            frameRate.Numerator(),
+            frameRate.Denominator());
+
+        FormatEntry format{};
+        format.mode.width = videoProperty.Width();
+        format.mode.height = videoProperty.Height();
+        format.mode.frameRate = { frameRate.Numerator(), frameRate.Denominator() };
+        format.mode.subTypeId = SubTypeIndex(table.subTypes, prop.Subtype());
+        format.itemIndex = static_cast<uint16_t>(table.properties.size());
+        format.detailIndex = 0;
+
+        table.properties.push_back(prop);
+        table.formats.push_back(format);
+    }
+
+    m_streamTables.push_back(std::move(table));
+
+    return m_streamTables.back();
+}
+
+_Use_decl_annotations_
+uint8_t DeviceCatalog::SubTypeIndex(
+    std::vector<hstring>& subTypes,
+    hstring const& subType)
+{
+    for (size_t i = 0; i < subTypes.size(); ++i)
+    {
+        if (_wcsicmp(subTypes[i].c_str(), subType.c_str()) == 0)
+        {
+            return static_cast<uint8_t>(i);
+        }
+    }
+
+    subTypes.push_back(subType);
+
+    return static_cast<uint8_t>(subTypes.size() - 1);
+}
+
+_Use_decl_annotations_
+DeviceCatalog::FormatEntry const* DeviceCatalog::SelectFormat(
+    std::vector<FormatEntry> const& formats,
+    std::vector<hstring> const& subTypes,
+    uint32_t width,
+    uint32_t height,
+    double frameRate,
+    hstring const& subType,
+    double& score)
+{
+    score = 0.0;
+
+    // a subtype the device does not offer gets an id no mode has
+    FormatRequest request{ width, height, FrameRate::FromDouble(frameRate), static_cast<uint32_t>(subTypes.size()) };
+    for (size_t i = 0; i < subTypes.size(); ++i)
+    {
+        if (_wcsicmp(subTypes[i].c_str(), subType.c_str()) == 0)
+        {
+            request.preferredSubTypeId = static_cast<uint32_t>(i);
+            break;
+        }
+    }
+
+    auto index = FormatSelector::SelectBest(formats, request, [](FormatEntry const& entry) -> FormatMode const& { return entry.mode; }, &score);
+    if (index == FormatSelector::NoMatch)
+    {
+        return nullptr;
+    }
+
+    auto const& format = formats[index];
+
+    Log(L"Selected format: %s: %i x %i @ %d/%d fps, score %f\n",
+        subTypes[format.mode.subTypeId].c_str(),
+        format.mode.width,
+        format.mode.height,
+        format.mode.frameRate.numerator,
+        format.mode.frameRate.denominator,
+        score);
+
+    return &format;
+}
+
+// call with m_mutex held
+_Use_decl_annotations_
+void DeviceCatalog::StartWatching(
+    DeviceClass const deviceClass,
+    Watch& watch)
+{
+    if (watch.watcher != nullptr)
+    {
+        return;
+    }
+
+    std::weak_ptr<DeviceCatalog> weak = shared_from_this();
+
+    auto onChanged = [weak, &watch]()
+    {
+        auto strong = weak.lock();
+        if (strong != nullptr && watch.isEnumerated.load(std::memory_order_acquire))
+        {
+            strong->Invalidate();
+        }
+    };
+
+    watch.watcher = DeviceInformation::CreateWatcher(deviceClass);
+
+    watch.addedRevoker = watch.watcher.Added(auto_revoke, [onChanged](auto const&, auto const&) { onChanged(); });
+    watch.removedRevoker = watch.watcher.Removed(auto_revoke, [onChanged](auto const&, auto const&) { onChanged(); });
+
+    // a device that is disabled stays in the list, only its enabled state is updated
+    watch.updatedRevoker = watch.watcher.Updated(auto_revoke, [onChanged](auto const&, DeviceInformationUpdate const& update)
+    {
+        if (update.Properties().HasKey(L"System.Devices.InterfaceEnabled"))
+        {
+            onChanged();
+        }
+    });
+    watch.completedRevoker = watch.watcher.EnumerationCompleted(auto_revoke, [&watch](auto const&, auto const&)
+    {
+        watch.isEnumerated.store(true, std::memory_order_release);
+    });
+
+    watch.watcher.Start();
+}
@@ -0,0 +1,141 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <winrt/windows.foundation.h>
+#include <winrt/windows.devices.enumeration.h>
+#include <winrt/windows.media.devices.h>
+#include <winrt/windows.media.mediaproperties.h>
+#include <winrt/windows.media.capture.h>
+
+#include "Media.FormatSelector.h"
+
+// Process wide cache of capture devices and what they can stream. Devices,
+// known video profiles and the available stream properties are queried once per
+// device and kept in a compact table; the cache is dropped when a capture
+// device is added or removed.
+class DeviceCatalog : public std::enable_shared_from_this<DeviceCatalog>
+{
+public:
+    static std::shared_ptr<DeviceCatalog> Instance();
+
+    DeviceCatalog();
+    ~DeviceCatalog();
+
+    winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Devices::Enumeration::DeviceInformation> GetFirstDeviceAsync(
+        _In_ winrt::Windows::Devices::Enumeration::DeviceClass const deviceClass);
+
+    bool IsVideoProfileSupported(
+        _In_ winrt::hstring const& deviceId);
+
+    // picks the closest description by FormatSelector score (0 is an exact match),
+    // returns false if the device has none
+    bool FindVideoProfile(
+        _In_ winrt::hstring const& deviceId,
+        _In_ winrt::Windows::Media::Capture::KnownVideoProfile const knownProfile,
+        _In_ winrt::Windows::Media::Capture::MediaStreamType const streamType,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _In_ double frameRate,
+        _In_ winrt::hstring const& subType,
+        _Out_ winrt::Windows::Media::Capture::MediaCaptureVideoProfile& profile,
+        _Out_ winrt::Windows::Media::Capture::MediaCaptureVideoProfileMediaDescription& description,
+        _Out_ double& score);
+
+    // closest video property by FormatSelector score, nullptr if there are none
+    winrt::Windows::Media::MediaProperties::IMediaEncodingProperties FindStreamProperties(
+        _In_ winrt::Windows::Media::Devices::VideoDeviceController const& videoDeviceController,
+        _In_ winrt::Windows::Media::Capture::MediaStreamType const streamType,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _In_ double frameRate,
+        _In_ winrt::hstring const& subType);
+
+    void Invalidate();
+
+private:
+    // one row per format, the mode's subTypeId indexes the table's subTypes
+    struct FormatEntry
+    {
+        FormatMode mode;
+        uint16_t itemIndex;     // profile or stream property
+        uint16_t detailIndex;   // media description, unused for stream properties
+    };
+
+    struct ProfileTable
+    {
+        winrt::hstring deviceId;
+        winrt::Windows::Media::Capture::KnownVideoProfile knownProfile;
+        std::vector<winrt::Windows::Media::Capture::MediaCaptureVideoProfile> profiles;
+        std::vector<std::vector<winrt::Windows::Media::Capture::MediaCaptureVideoProfileMediaDescription>> previewDescriptions;
+        std::vector<std::vector<winrt::Windows::Media::Capture::MediaCaptureVideoProfileMediaDescription>> recordDescriptions;
+        std::vector<winrt::hstring> subTypes;
+        std::vector<FormatEntry> previewFormats;
+        std::vector<FormatEntry> recordFormats;
+    };
+
+    struct StreamTable
+    {
+        winrt::hstring deviceId;
+        winrt::Windows::Media::Capture::MediaStreamType streamType;
+        std::vector<winrt::Windows::Media::MediaProperties::IMediaEncodingProperties> properties;
+        std::vector<winrt::hstring> subTypes;
+        std::vector<FormatEntry> formats;
+    };
+
+    // the initial enumeration also raises Added, only changes after it invalidate.
+    // isEnumerated is set on the watcher thread and read by the change handlers.
+    struct Watch
+    {
+        winrt::Windows::Devices::Enumeration::DeviceWatcher watcher{ nullptr };
+        winrt::Windows::Devices::Enumeration::DeviceWatcher::Added_revoker addedRevoker;
+        winrt::Windows::Devices::Enumeration::DeviceWatcher::Removed_revoker removedRevoker;
+        winrt::Windows::Devices::Enumeration::DeviceWatcher::Updated_revoker updatedRevoker;
+        winrt::Windows::Devices::Enumeration::DeviceWatcher::EnumerationCompleted_revoker completedRevoker;
+        std::atomic<bool> isEnumerated{ false };
+    };
+
+    // call with m_mutex held, the reference is only valid while it is
+    ProfileTable const& GetProfileTable(
+        _In_ winrt::hstring const& deviceId,
+        _In_ winrt::Windows::Media::Capture::KnownVideoProfile const knownProfile);
+
+    StreamTable const& GetStreamTable(
+        _In_ winrt::Windows::Media::Devices::VideoDeviceController const& videoDeviceController,
+        _In_ winrt::Windows::Media::Capture::MediaStreamType const streamType);
+
+    static uint8_t SubTypeIndex(
+        _Inout_ std::vector<winrt::hstring>& subTypes,
+        _In_ winrt::hstring const& subType);
+
+    static FormatEntry const* SelectFormat(
+        _In_ std::vector<FormatEntry> const& formats,
+        _In_ std::vector<winrt::hstring> const& subTypes,
+        _In_ uint32_t width,
+        _In_ uint32_t height,
+        _In_ double frameRate,
+        _In_ winrt::hstring const& subType,
+        _Out_ double& score);
+
+    void StartWatching(
+        _In_ winrt::Windows::Devices::Enumeration::DeviceClass const deviceClass,
+        _Inout_ Watch& watch);
+
+private:
+    std::mutex m_mutex;
+
+    winrt::Windows::Devices::Enumeration::DeviceInformation m_videoDevice;
+    winrt::Windows::Devices::Enumeration::DeviceInformation m_audioDevice;
+    std::vector<std::pair<winrt::hstring, bool>> m_profileSupport;
+    std::vector<ProfileTable> m_profileTables;
+    std::vector<StreamTable> m_streamTables;
+
+    Watch m_videoWatch;
+    Watch m_audioWatch;
+};
@@ -0,0 +1,53 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <functional>
+
+// Schedules work for the capture pipeline, implemented on Media Foundation work
+// queues by WorkQueueExecutor in Media.WorkQueueExecutor.h.
+struct IExecutor
+{
+    virtual ~IExecutor() = default;
+
+    // returns false if the executor has been shut down and the work was not queued
+    virtual bool Post(std::function<void()> work) = 0;
+
+    // as Post, but once queued the work runs even if the executor is shut down before
+    // it gets to it, then on the thread that discards it; for coroutine resumes, a
+    // dropped one never completes its operation
+    virtual bool PostMustRun(std::function<void()> work) = 0;
+
+    // stops accepting work, anything still queued is discarded unless it must run
+    virtual void Shutdown() = 0;
+};
+
+// co_await resume_on(executor) continues the coroutine on a thread of the executor,
+// or inline if the executor no longer accepts work. Always resumed, also when the
+// executor is shut down while the resume is queued.
+struct resume_on
+{
+    explicit resume_on(IExecutor& executor)
+        : m_executor(executor)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    template <typename CoroutineHandle>
+    bool await_suspend(CoroutineHandle handle)
+    {
+        return m_executor.PostMustRun([handle]() { handle(); });
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+private:
+    IExecutor& m_executor;
+};
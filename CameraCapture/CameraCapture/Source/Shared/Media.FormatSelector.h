@@ -0,0 +1,162 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// Frame rate kept as a ratio so 30000/1001 and 30/1 compare exactly
+struct FrameRate
+{
+    uint32_t numerator;
+    uint32_t denominator;
+
+    double Value() const
+    {
+        return denominator != 0 ? static_cast<double>(numerator) / denominator : 0.0;
+    }
+
+    // profile descriptions only report a double, NTSC rates snap to n/1001
+    static FrameRate FromDouble(double framesPerSecond)
+    {
+        if (framesPerSecond <= 0.0)
+        {
+            return { 0, 1 };
+        }
+
+        auto ntsc = framesPerSecond * 1.001;
+        auto ntscRounded = std::round(ntsc);
+        if (std::abs(ntsc - ntscRounded) < 0.0005 && std::abs(framesPerSecond - ntscRounded) > 0.0005)
+        {
+            return { static_cast<uint32_t>(ntscRounded) * 1000, 1001 };
+        }
+
+        return { static_cast<uint32_t>(std::round(framesPerSecond * 1000.0)), 1000 };
+    }
+};
+
+// One capture mode of a device, subTypeId is whatever id the caller uses for subtypes
+struct FormatMode
+{
+    uint32_t width;
+    uint32_t height;
+    FrameRate frameRate;
+    uint32_t subTypeId;
+};
+
+struct FormatRequest
+{
+    uint32_t width;
+    uint32_t height;
+    FrameRate frameRate;
+    uint32_t preferredSubTypeId;
+};
+
+// Scores capture modes against a request, lower is better and 0 is an exact match.
+// Modes that would need upscaling or cannot reach the requested frame rate are
+// penalized over ones that are larger or faster; among modes that all satisfy the
+// request the one with the least bandwidth wins.
+struct FormatSelector
+{
+    static constexpr size_t NoMatch = std::numeric_limits<size_t>::max();
+
+    static double Score(FormatMode const& mode, FormatRequest const& request)
+    {
+        if (mode.width == 0 || mode.height == 0 || request.width == 0 || request.height == 0)
+        {
+            return std::numeric_limits<double>::max();
+        }
+
+        double score = 0.0;
+
+        // resolution, in relative area so the weight does not depend on the sensor size
+        auto requestArea = static_cast<double>(request.width) * request.height;
+        auto modeArea = static_cast<double>(mode.width) * mode.height;
+        if (mode.width < request.width || mode.height < request.height)
+        {
+            // would have to be scaled up, worst case
+            score += UpscaleWeight * (requestArea - std::fmin(modeArea, requestArea)) / requestArea;
+            score += UpscaleWeight * 0.25;
+        }
+        else
+        {
+            score += DownscaleWeight * (modeArea - requestArea) / requestArea;
+        }
+
+        // a different aspect ratio means cropping or letterboxing
+        auto requestAspect = static_cast<double>(request.width) / request.height;
+        auto modeAspect = static_cast<double>(mode.width) / mode.height;
+        score += AspectWeight * std::abs(std::log(modeAspect / requestAspect));
+
+        // frame rate, reaching the target matters more than exceeding it
+        auto requestRate = request.frameRate.Value();
+        auto modeRate = mode.frameRate.Value();
+        if (requestRate > 0.0)
+        {
+            // within half a percent counts as the same rate, 29.97 serves a 30 fps request
+            if (modeRate < requestRate * (1.0 - RateTolerance))
+            {
+                score += SlowWeight * (requestRate - modeRate) / requestRate;
+                score += SlowWeight * 0.25;
+            }
+            else if (modeRate > requestRate * (1.0 + RateTolerance))
+            {
+                score += FastWeight * (modeRate - requestRate) / requestRate;
+            }
+        }
+
+        if (mode.subTypeId != request.preferredSubTypeId)
+        {
+            score += SubTypeWeight;
+        }
+
+        return score;
+    }
+
+    // returns the index of the best mode, NoMatch if there are none;
+    // modeOf maps an element of the range to its FormatMode
+    template <typename Range, typename ModeOf>
+    static size_t SelectBest(Range const& range, FormatRequest const& request, ModeOf&& modeOf, double* pScore = nullptr)
+    {
+        size_t bestIndex = NoMatch;
+        double bestScore = std::numeric_limits<double>::max();
+        double bestBandwidth = std::numeric_limits<double>::max();
+
+        size_t index = 0;
+        for (auto const& item : range)
+        {
+            FormatMode const& mode = modeOf(item);
+
+            auto score = Score(mode, request);
+            auto bandwidth = static_cast<double>(mode.width) * mode.height * mode.frameRate.Value();
+
+            // ties go to the cheaper mode, then to the first one listed
+            if (score < bestScore || (score == bestScore && bandwidth < bestBandwidth))
+            {
+                bestIndex = index;
+                bestScore = score;
+                bestBandwidth = bandwidth;
+            }
+
+            ++index;
+        }
+
+        if (pScore != nullptr)
+        {
+            *pScore = bestScore;
+        }
+
+        return bestIndex;
+    }
+
+private:
+    static constexpr double UpscaleWeight = 8.0;
+    static constexpr double DownscaleWeight = 1.0;
+    static constexpr double AspectWeight = 4.0;
+    static constexpr double SlowWeight = 6.0;
+    static constexpr double FastWeight = 0.5;
+    static constexpr double SubTypeWeight = 0.75;
+    static constexpr double RateTolerance = 0.005;
+};
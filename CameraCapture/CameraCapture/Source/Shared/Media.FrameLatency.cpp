@@ -0,0 +1,110 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "Media.FrameLatency.h"
+
+#include <mfapi.h>
+
+EXTERN_GUID(MFSampleExtension_DeviceTimestamp, 0x8f3e35e7, 0x2dcd, 0x4887, 0x86, 0x22, 0x2a, 0x58, 0xba, 0xa6, 0x52, 0xb0);
+
+std::shared_ptr<FrameLatency> FrameLatency::Instance()
+{
+    static std::shared_ptr<FrameLatency> s_instance = std::make_shared<FrameLatency>();
+
+    return s_instance;
+}
+
+FrameLatency::FrameLatency()
+{
+}
+
+_Use_decl_annotations_
+int64_t FrameLatency::DeviceTimestamp(
+    IMFSample* pSample)
+{
+    UINT64 deviceTimestamp = 0;
+    if (pSample == nullptr || FAILED(pSample->GetUINT64(MFSampleExtension_DeviceTimestamp, &deviceTimestamp)))
+    {
+        return 0;
+    }
+
+    return static_cast<int64_t>(deviceTimestamp);
+}
+
+int64_t FrameLatency::Now()
+{
+    static const int64_t s_frequency = []()
+    {
+        LARGE_INTEGER frequency{};
+
+        return QueryPerformanceFrequency(&frequency) ? frequency.QuadPart : 0;
+    }();
+
+    LARGE_INTEGER counter{};
+    if (s_frequency == 0 || !QueryPerformanceCounter(&counter))
+    {
+        return 0;
+    }
+
+    // split to avoid overflowing the multiplication
+    auto seconds = counter.QuadPart / s_frequency;
+    auto remainder = counter.QuadPart % s_frequency;
+
+    return seconds * 10000000 + remainder * 10000000 / s_frequency;
+}
+
+_Use_decl_annotations_
+void FrameLatency::Record(
+    LatencyStage stage,
+    int64_t deviceTimestamp)
+{
+    if (deviceTimestamp == 0 || stage < LatencyStage::SinkArrival || stage >= LatencyStage::Count)
+    {
+        return;
+    }
+
+    auto now = Now();
+    if (now < deviceTimestamp)
+    {
+        return;
+    }
+
+    // 100ns to microseconds
+    m_stages[static_cast<size_t>(stage)].Record(static_cast<uint64_t>(now - deviceTimestamp) / 10);
+}
+
+_Use_decl_annotations_
+HRESULT FrameLatency::GetStats(
+    LatencyStage stage,
+    LATENCY_STATS* pStats) const
+{
+    NULL_CHK_HR(pStats, E_INVALIDARG);
+
+    ZeroMemory(pStats, sizeof(LATENCY_STATS));
+
+    if (stage < LatencyStage::SinkArrival || stage >= LatencyStage::Count)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    auto snapshot = m_stages[static_cast<size_t>(stage)].Read();
+
+    pStats->count = snapshot.count;
+    pStats->minimum = static_cast<uint32_t>(snapshot.minimum);
+    pStats->maximum = static_cast<uint32_t>(snapshot.maximum);
+    pStats->mean = static_cast<uint32_t>(snapshot.mean);
+    pStats->p50 = static_cast<uint32_t>(snapshot.p50);
+    pStats->p90 = static_cast<uint32_t>(snapshot.p90);
+    pStats->p99 = static_cast<uint32_t>(snapshot.p99);
+
+    return S_OK;
+}
+
+void FrameLatency::Reset()
+{
+    for (auto&& stage : m_stages)
+    {
+        stage.Reset();
+    }
+}
@@ -0,0 +1,49 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "Media.LatencyHistogram.h"
+
+#include <array>
+#include <memory>
+
+#include <mfobjects.h>
+
+// Per stage histograms of how long after capture a video frame got there, measured
+// from MFSampleExtension_DeviceTimestamp against the current QPC time. Shared by
+// every capture in the process; frames without a device timestamp are not counted.
+class FrameLatency
+{
+public:
+    static std::shared_ptr<FrameLatency> Instance();
+
+    FrameLatency();
+
+    // the sample's MFSampleExtension_DeviceTimestamp, 0 if it has none
+    static int64_t DeviceTimestamp(
+        _In_opt_ IMFSample* pSample);
+
+    // current QPC time in 100ns units, the base device timestamps are in
+    static int64_t Now();
+
+    void Record(
+        _In_ LatencyStage stage,
+        _In_ int64_t deviceTimestamp);
+
+    void Record(
+        _In_ LatencyStage stage,
+        _In_opt_ IMFSample* pSample)
+    {
+        Record(stage, DeviceTimestamp(pSample));
+    }
+
+    HRESULT GetStats(
+        _In_ LatencyStage stage,
+        _Out_ LATENCY_STATS* pStats) const;
+
+    void Reset();
+
+private:
+    std::array<LatencyHistogram, static_cast<size_t>(LatencyStage::Count)> m_stages;
+};
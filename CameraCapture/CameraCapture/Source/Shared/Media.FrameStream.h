@@ -0,0 +1,260 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "Media.Executor.h"
+
+// What a subscription does when its buffer is full and another frame arrives
+enum class FrameStreamPolicy
+{
+    DropOldest, // keep the most recent frames, consumer sees the latest data
+    DropNewest  // keep the queued frames, new frames are discarded until there is room
+};
+
+// Bounded per-subscriber frame buffer that is pushed from the pipeline and
+// pulled by a coroutine at its own pace:
+//
+//     while (auto frame = co_await stream->next_frame())
+//     {
+//         ...
+//     }
+//
+// Push never blocks. A waiting consumer is resumed on the executor given at
+// construction so it never runs on the pipeline thread. next_frame() returns
+// an empty optional once the stream is closed and drained.
+template <typename T>
+class FrameStream : public std::enable_shared_from_this<FrameStream<T>>
+{
+public:
+    FrameStream(size_t capacity, FrameStreamPolicy policy, std::shared_ptr<IExecutor> const& executor)
+        : m_capacity(capacity > 0 ? capacity : 1)
+        , m_policy(policy)
+        , m_executor(executor)
+        , m_waiterFrame(nullptr)
+        , m_isClosed(false)
+        , m_droppedCount(0)
+    {
+    }
+
+    size_t Capacity() const { return m_capacity; }
+    FrameStreamPolicy Policy() const { return m_policy; }
+
+    bool IsClosed() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return m_isClosed;
+    }
+
+    // frames discarded by the buffering policy or a flush
+    uint64_t DroppedCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return m_droppedCount;
+    }
+
+    // returns false if the stream is closed or the frame was dropped by the policy
+    bool Push(T const& frame)
+    {
+        std::function<void()> waiter = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (m_isClosed)
+            {
+                return false;
+            }
+
+            // a waiting consumer gets the frame handed over, a flush before it resumes
+            // cannot take it away and end its loop early
+            if (m_waiter != nullptr)
+            {
+                m_waiterFrame->emplace(frame);
+                m_waiterFrame = nullptr;
+
+                waiter = std::move(m_waiter);
+                m_waiter = nullptr;
+            }
+            else
+            {
+                if (m_frames.size() >= m_capacity)
+                {
+                    ++m_droppedCount;
+
+                    if (m_policy == FrameStreamPolicy::DropNewest)
+                    {
+                        return false;
+                    }
+
+                    m_frames.pop_front();
+                }
+
+                m_frames.push_back(frame);
+            }
+        }
+
+        Resume(waiter);
+
+        return true;
+    }
+
+    // discards buffered frames, the stream stays open
+    void Flush()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_droppedCount += m_frames.size();
+        m_frames.clear();
+    }
+
+    // ends the stream, frames already buffered are still delivered
+    void Close()
+    {
+        std::function<void()> waiter = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (m_isClosed)
+            {
+                return;
+            }
+
+            m_isClosed = true;
+
+            waiter = std::move(m_waiter);
+            m_waiter = nullptr;
+            m_waiterFrame = nullptr;
+        }
+
+        Resume(waiter);
+    }
+
+    // non blocking pull, for consumers polling from their own loop
+    bool TryPop(T& frame)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_frames.empty())
+        {
+            return false;
+        }
+
+        frame = std::move(m_frames.front());
+        m_frames.pop_front();
+
+        return true;
+    }
+
+    struct next_frame_awaiter
+    {
+        explicit next_frame_awaiter(std::shared_ptr<FrameStream> const& stream)
+            : m_stream(stream)
+        {
+        }
+
+        bool await_ready()
+        {
+            return m_stream->TryTake(m_frame);
+        }
+
+        template <typename CoroutineHandle>
+        bool await_suspend(CoroutineHandle handle)
+        {
+            return m_stream->Wait(m_frame, [handle]() { handle(); });
+        }
+
+        std::optional<T> await_resume()
+        {
+            // a push hands its frame over before resuming, only a close resumes without one
+            return std::move(m_frame);
+        }
+
+    private:
+        std::shared_ptr<FrameStream> m_stream;
+        std::optional<T> m_frame;
+    };
+
+    // only one coroutine may wait on a stream at a time
+    next_frame_awaiter next_frame()
+    {
+        return next_frame_awaiter(this->shared_from_this());
+    }
+
+private:
+    // true if a frame is available or the stream has ended
+    bool TryTake(std::optional<T>& frame)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_frames.empty())
+        {
+            frame.emplace(std::move(m_frames.front()));
+            m_frames.pop_front();
+
+            return true;
+        }
+
+        return m_isClosed;
+    }
+
+    // returns false if the coroutine should continue without suspending
+    bool Wait(std::optional<T>& frame, std::function<void()>&& resume)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // a frame may have arrived between await_ready and await_suspend
+        if (!m_frames.empty())
+        {
+            frame.emplace(std::move(m_frames.front()));
+            m_frames.pop_front();
+
+            return false;
+        }
+
+        if (m_isClosed)
+        {
+            return false;
+        }
+
+        m_waiter = std::move(resume);
+        m_waiterFrame = &frame;
+
+        return true;
+    }
+
+    void Resume(std::function<void()>& waiter)
+    {
+        if (waiter == nullptr)
+        {
+            return;
+        }
+
+        if (m_executor == nullptr || !m_executor->PostMustRun(waiter))
+        {
+            waiter();
+        }
+    }
+
+private:
+    size_t const m_capacity;
+    FrameStreamPolicy const m_policy;
+    std::shared_ptr<IExecutor> m_executor;
+
+    mutable std::mutex m_mutex;
+    std::deque<T> m_frames;
+    std::function<void()> m_waiter;
+    std::optional<T>* m_waiterFrame;
+    bool m_isClosed;
+    uint64_t m_droppedCount;
+};
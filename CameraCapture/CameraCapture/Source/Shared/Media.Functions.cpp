@@ -3,6 +3,7 @@
 
 #include "pch.h"
 #include "Media.Functions.h"
+#include "Media.FormatSelector.h"
 
 #include <mfapi.h>
 #include <mferror.h>
@@ -176,53 +177,58 @@ IMediaEncodingProperties GetVideoDeviceProperties(
 
     setlocale(LC_ALL, "");
 
-    IMediaEncodingProperties mediaEncodingProperty = nullptr;
-    auto const& found = std::find_if(begin(preferredSettings), end(preferredSettings), [&](IMediaEncodingProperties const& prop)
+    std::vector<IMediaEncodingProperties> properties;
+    std::vector<FormatMode> modes;
+    properties.reserve(preferredSettings.Size());
+    modes.reserve(preferredSettings.Size());
+
+    // the requested subtype is id 1, everything else 0
+    for (auto const& prop : preferredSettings)
+    {
+        // validate it is video
+        if (prop.Type() != L"Video")
         {
-            // validate it is video
-            if (prop.Type() != L"Video")
-            {
-                false;
-            }
+            continue;
+        }
 
-            auto videoProperty = prop.as<IVideoEncodingProperties>();
+        auto videoProperty = prop.as<IVideoEncodingProperties>();
 
-            if (mediaEncodingProperty == nullptr)
-            {
-                mediaEncodingProperty = videoProperty;
-            }
+        Log(L"\tFormat: %s: %i x %i @ %d/%d fps\n",
+            prop.Subtype().c_str(),
+            videoProperty.Width(),
+            videoProperty.Height(),
+            videoProperty.FrameRate().Numerator(),
+            videoProperty.FrameRate().Denominator());
 
-            Log(L"\tFormat: %s: %i x %i @ %d/%d fps",
-                prop.Subtype().c_str(),
-                videoProperty.Width(),
-                videoProperty.Height(),
-                videoProperty.FrameRate().Numerator(),
-                videoProperty.FrameRate().Denominator());
-
-            // select a size that will be == width/height @ 30fps, final size will be set with enc props
-            double fps = videoProperty.FrameRate().Numerator() / videoProperty.FrameRate().Denominator();
-            bool match =
-                _wcsicmp(videoProperty.Subtype().c_str(), subType.c_str()) == 0 &&
-                videoProperty.Width() == width &&
-                videoProperty.Height() == height &&
-                fps == 30.0;
-            if (match)
-            {
-                Log(L" - found\n");
-            }
-            else
-            {
-                Log(L"\n");
-            }
+        FormatMode mode{};
+        mode.width = videoProperty.Width();
+        mode.height = videoProperty.Height();
+        mode.frameRate = { videoProperty.FrameRate().Numerator(), videoProperty.FrameRate().Denominator() };
+        mode.subTypeId = _wcsicmp(videoProperty.Subtype().c_str(), subType.c_str()) == 0 ? 1 : 0;
+
+        properties.push_back(prop);
+        modes.push_back(mode);
+    }
 
-            return match;
-        });
+    // closest to width/height @ 30fps, final size will be set with enc props
+    FormatRequest request{ width, height, { 30, 1 }, 1 };
 
-    if (found != end(preferredSettings))
+    double score = 0.0;
+    auto index = FormatSelector::SelectBest(modes, request, [](FormatMode const& mode) -> FormatMode const& { return mode; }, &score);
+    if (index == FormatSelector::NoMatch)
     {
-        mediaEncodingProperty = *found;
+        return nullptr;
     }
 
+    Log(L"Selected format %i x %i @ %d/%d fps, score %f\n",
+        modes[index].width,
+        modes[index].height,
+        modes[index].frameRate.numerator,
+        modes[index].frameRate.denominator,
+        score);
+
+    IMediaEncodingProperties mediaEncodingProperty = properties[index];
+
     return mediaEncodingProperty;
 }
 
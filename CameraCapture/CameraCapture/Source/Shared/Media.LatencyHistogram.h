@@ -0,0 +1,188 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock free log linear histogram of latencies in microseconds, in the spirit of an
+// HDR histogram: values below SubBucketCount are counted exactly, above that each
+// power of two range is split into SubBucketCount / 2 buckets, so any value is
+// reported within about 3%. Record can run on any number of threads at once; a
+// snapshot taken while values are recorded may be off by the values in flight.
+class LatencyHistogram
+{
+public:
+    static constexpr uint32_t SubBucketCount = 32;
+    static constexpr uint32_t MaxExponent = 32;     // values are clamped to 2^32 - 1 us
+    static constexpr uint32_t BucketCount = SubBucketCount + (MaxExponent - 5) * (SubBucketCount / 2);
+
+    struct Snapshot
+    {
+        uint64_t count;
+        uint64_t minimum;
+        uint64_t maximum;
+        uint64_t mean;
+        uint64_t p50;
+        uint64_t p90;
+        uint64_t p99;
+    };
+
+    LatencyHistogram()
+    {
+        Reset();
+    }
+
+    void Record(uint64_t value)
+    {
+        if (value > MaxValue)
+        {
+            value = MaxValue;
+        }
+
+        m_buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+
+        auto minimum = m_minimum.load(std::memory_order_relaxed);
+        while (value < minimum && !m_minimum.compare_exchange_weak(minimum, value, std::memory_order_relaxed))
+        {
+        }
+
+        auto maximum = m_maximum.load(std::memory_order_relaxed);
+        while (value > maximum && !m_maximum.compare_exchange_weak(maximum, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void Reset()
+    {
+        for (auto&& bucket : m_buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+
+        m_count.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_minimum.store(UINT64_MAX, std::memory_order_relaxed);
+        m_maximum.store(0, std::memory_order_relaxed);
+    }
+
+    Snapshot Read() const
+    {
+        Snapshot snapshot{};
+
+        std::array<uint64_t, BucketCount> counts;
+
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < BucketCount; ++i)
+        {
+            counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+
+        if (total == 0)
+        {
+            return snapshot;
+        }
+
+        snapshot.count = total;
+        snapshot.minimum = m_minimum.load(std::memory_order_relaxed);
+        snapshot.maximum = m_maximum.load(std::memory_order_relaxed);
+        // a Reset since the buckets were read can leave the count at 0
+        auto count = m_count.load(std::memory_order_relaxed);
+        snapshot.mean = m_sum.load(std::memory_order_relaxed) / (count != 0 ? count : total);
+        snapshot.p50 = ValueAtPercentile(counts, total, 50.0);
+        snapshot.p90 = ValueAtPercentile(counts, total, 90.0);
+        snapshot.p99 = ValueAtPercentile(counts, total, 99.0);
+
+        // bucket midpoints can fall outside the recorded range
+        for (auto value : { &snapshot.p50, &snapshot.p90, &snapshot.p99 })
+        {
+            if (*value < snapshot.minimum)
+            {
+                *value = snapshot.minimum;
+            }
+            if (*value > snapshot.maximum)
+            {
+                *value = snapshot.maximum;
+            }
+        }
+
+        return snapshot;
+    }
+
+private:
+    static constexpr uint64_t MaxValue = (1ull << MaxExponent) - 1;
+    static constexpr uint32_t HalfCount = SubBucketCount / 2;
+
+    static uint32_t HighestBit(uint64_t value)
+    {
+        uint32_t bit = 0;
+        while (value >>= 1)
+        {
+            ++bit;
+        }
+
+        return bit;
+    }
+
+    static uint32_t BucketIndex(uint64_t value)
+    {
+        if (value < SubBucketCount)
+        {
+            return static_cast<uint32_t>(value);
+        }
+
+        // keep the top five bits, the leading one selects the power of two range
+        auto exponent = HighestBit(value);
+        auto subBucket = static_cast<uint32_t>(value >> (exponent - 4));
+
+        return SubBucketCount + (exponent - 5) * HalfCount + (subBucket - HalfCount);
+    }
+
+    // the middle of the range a bucket counts
+    static uint64_t BucketValue(uint32_t index)
+    {
+        if (index < SubBucketCount)
+        {
+            return index;
+        }
+
+        auto exponent = (index - SubBucketCount) / HalfCount + 5;
+        auto subBucket = (index - SubBucketCount) % HalfCount + HalfCount;
+        auto shift = exponent - 4;
+
+        return (static_cast<uint64_t>(subBucket) << shift) + ((1ull << shift) >> 1);
+    }
+
+    static uint64_t ValueAtPercentile(std::array<uint64_t, BucketCount> const& counts, uint64_t total, double percentile)
+    {
+        auto target = static_cast<uint64_t>(total * percentile / 100.0 + 0.5);
+        if (target == 0)
+        {
+            target = 1;
+        }
+
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BucketCount; ++i)
+        {
+            seen += counts[i];
+            if (seen >= target)
+            {
+                return BucketValue(i);
+            }
+        }
+
+        return BucketValue(BucketCount - 1);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BucketCount> m_buckets;
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_minimum;
+    std::atomic<uint64_t> m_maximum;
+};
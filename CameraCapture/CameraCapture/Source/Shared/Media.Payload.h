@@ -21,6 +21,10 @@ extern const __declspec(selectany) winrt::guid MF_PAYLOAD_MARKER_TICK =
 extern const __declspec(selectany) winrt::guid MF_PAYLOAD_MARKER_TICK_TIMESTAMP =
 { 0x86e63da3, 0xa537, 0x4887, { 0xae, 0x1a, 0x18, 0xbb, 0xe9, 0x9f, 0xce, 0x9 } };
 
+// {3A1E6F5C-8B2D-4C7E-9F41-6D0B5A2C8E17}, UINT32 FrameFlags of a video sample
+extern const __declspec(selectany) winrt::guid MF_PAYLOAD_FRAME_FLAGS =
+    { 0x3a1e6f5c, 0x8b2d, 0x4c7e, { 0x9f, 0x41, 0x6d, 0xb, 0x5a, 0x2c, 0x8e, 0x17 } };
+
 struct __declspec(uuid("8300b3cc-c919-4c54-b01a-b375b843d3f8")) IStreamSample : ::IUnknown
 {
     virtual winrt::com_ptr<IMFSample> __stdcall Sample() = 0;
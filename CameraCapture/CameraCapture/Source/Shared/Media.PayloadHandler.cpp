@@ -5,6 +5,8 @@
 #include "Media.PayloadHandler.h"
 #include "Media.PayloadHandler.g.cpp"
 #include "Media.Payload.h"
+#include "Media.WorkQueueExecutor.h"
+#include "Media.FrameLatency.h"
 
 #include <winrt/windows.media.h>
 #include <winrt/windows.media.core.h>
@@ -14,15 +16,180 @@ using namespace CameraCapture::Media::implementation;
 using namespace Windows::Media::Core;
 using namespace Windows::Media::MediaProperties;
 
+EXTERN_GUID(MFSampleExtension_DeviceTimestamp, 0x8f3e35e7, 0x2dcd, 0x4887, 0x86, 0x22, 0x2a, 0x58, 0xba, 0xa6, 0x52, 0xb0);
+
+// reads the major type and times used to pair a payload, false if it has no sample
+static bool GetAvTimestamp(
+    _In_ CameraCapture::Media::Payload const& payload,
+    _Out_ GUID& majorType,
+    _Out_ AvTimestamp& time)
+{
+    majorType = GUID_NULL;
+    time = {};
+
+    auto mediaStreamSample = payload.MediaStreamSample();
+    if (mediaStreamSample != nullptr)
+    {
+        auto type = mediaStreamSample.ExtendedProperties().TryLookup(MF_MT_MAJOR_TYPE);
+        if (type != nullptr)
+        {
+            majorType = winrt::unbox_value<guid>(type);
+        }
+    }
+
+    auto streamSample = payload.try_as<IStreamSample>();
+    if (streamSample == nullptr || streamSample->Sample() == nullptr)
+    {
+        return false;
+    }
+
+    auto sample = streamSample->Sample();
+
+    LONGLONG sampleTime = 0;
+    if (FAILED(sample->GetSampleTime(&sampleTime)))
+    {
+        return false;
+    }
+
+    LONGLONG duration = 0;
+    if (FAILED(sample->GetSampleDuration(&duration)))
+    {
+        duration = 0;
+    }
+
+    UINT64 deviceTime = 0;
+    time.hasDeviceTime = SUCCEEDED(sample->GetUINT64(MFSampleExtension_DeviceTimestamp, &deviceTime));
+
+    time.sampleTime = sampleTime;
+    time.duration = duration;
+    time.deviceTime = static_cast<int64_t>(deviceTime);
+
+    return true;
+}
+
+// luma of a sparse grid of pixels, for NV12 and 32 bit RGB frames
+static bool SampleLuma(
+    _In_ CameraCapture::Media::Payload const& payload,
+    _Out_ RedundantFrameDetector::LumaSamples& luma)
+{
+    luma.fill(0);
+
+    auto streamSample = payload.try_as<IStreamSample>();
+    if (streamSample == nullptr || streamSample->Sample() == nullptr)
+    {
+        return false;
+    }
+
+    auto videoProps = payload.EncodingProperties().try_as<IVideoEncodingProperties>();
+    if (videoProps == nullptr || videoProps.Width() == 0 || videoProps.Height() == 0)
+    {
+        return false;
+    }
+
+    auto subtype = videoProps.Subtype();
+
+    LONG bytesPerPixel = 0;
+    if (_wcsicmp(subtype.c_str(), MediaEncodingSubtypes::Nv12().c_str()) == 0)
+    {
+        bytesPerPixel = 1;
+    }
+    else if (_wcsicmp(subtype.c_str(), MediaEncodingSubtypes::Bgra8().c_str()) == 0
+        || _wcsicmp(subtype.c_str(), MediaEncodingSubtypes::Argb32().c_str()) == 0
+        || _wcsicmp(subtype.c_str(), MediaEncodingSubtypes::Rgb32().c_str()) == 0)
+    {
+        bytesPerPixel = 4;
+    }
+    else
+    {
+        return false;
+    }
+
+    auto width = videoProps.Width();
+    auto height = videoProps.Height();
+
+    com_ptr<IMFMediaBuffer> buffer = nullptr;
+    if (FAILED(streamSample->Sample()->GetBufferByIndex(0, buffer.put())))
+    {
+        return false;
+    }
+
+    // a buffer in video memory is read back here, the check is opt in
+    BYTE* scanline0 = nullptr;
+    LONG pitch = 0;
+    auto buffer2d = buffer.try_as<IMF2DBuffer>();
+    if (buffer2d != nullptr)
+    {
+        if (FAILED(buffer2d->Lock2D(&scanline0, &pitch)))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        DWORD length = 0;
+        if (FAILED(buffer->Lock(&scanline0, nullptr, &length)))
+        {
+            return false;
+        }
+
+        pitch = static_cast<LONG>(width) * bytesPerPixel;
+        if (length < static_cast<DWORD>(pitch) * height)
+        {
+            buffer->Unlock();
+
+            return false;
+        }
+    }
+
+    for (size_t gridY = 0; gridY < RedundantFrameDetector::LumaGridHeight; ++gridY)
+    {
+        auto y = static_cast<LONG>((gridY * 2 + 1) * height / (RedundantFrameDetector::LumaGridHeight * 2));
+        auto row = scanline0 + static_cast<ptrdiff_t>(y) * pitch;
+
+        for (size_t gridX = 0; gridX < RedundantFrameDetector::LumaGridWidth; ++gridX)
+        {
+            auto x = static_cast<LONG>((gridX * 2 + 1) * width / (RedundantFrameDetector::LumaGridWidth * 2));
+            auto pixel = row + static_cast<ptrdiff_t>(x) * bytesPerPixel;
+
+            // BT.601 weights on B, G, R bytes
+            luma[gridY * RedundantFrameDetector::LumaGridWidth + gridX] = bytesPerPixel == 1
+                ? pixel[0]
+                : static_cast<uint8_t>((pixel[0] * 29 + pixel[1] * 150 + pixel[2] * 77) >> 8);
+        }
+    }
+
+    if (buffer2d != nullptr)
+    {
+        buffer2d->Unlock2D();
+    }
+    else
+    {
+        buffer->Unlock();
+    }
+
+    return true;
+}
+
 PayloadHandler::PayloadHandler()
     : m_isShutdown(false)
-    , m_workItemQueueId(MFASYNC_CALLBACK_QUEUE_UNDEFINED)
+    , m_executor(nullptr)
+    , m_streamExecutor(nullptr)
+    , m_isAvSyncActive(false)
+    , m_isRedundantDetectionEnabled(false)
+    , m_redundantThresholds{ 0.0f, 0.0f, 0.0f, 0 }
+    , m_redundantSettingsVersion(0)
+    , m_appliedRedundantSettingsVersion(0)
     , m_transform(CameraCapture::Media::Transform())
     , m_appCoordinateSystem(nullptr)
+    , m_poseExecutor(nullptr)
+    , m_isPoseDrainQueued(false)
+    , m_hasProjection(false)
+    , m_projection(Windows::Foundation::Numerics::float4x4::identity())
+    , m_dispatchLocatedTime(-1)
 {
     IFT(MFStartup(MF_VERSION));
 
-    IFT(MFAllocateSerialWorkQueue(MFASYNC_CALLBACK_QUEUE_MULTITHREADED, &m_workItemQueueId));
+    m_executor = WorkQueueExecutor::CreateSerial();
 }
 
 Windows::Perception::Spatial::SpatialCoordinateSystem PayloadHandler::AppCoordinateSystem()
@@ -35,43 +202,334 @@ void PayloadHandler::AppCoordinateSystem(Windows::Perception::Spatial::SpatialCo
     m_appCoordinateSystem = value;
 }
 
+_Use_decl_annotations_
+void PayloadHandler::AddDecimation(
+    std::shared_ptr<SubscriberDecimation> const& decimation)
+{
+    NULL_CHK_R(decimation);
+
+    auto guard = m_cs.Guard();
+
+    if (std::find(m_decimations.begin(), m_decimations.end(), decimation) == m_decimations.end())
+    {
+        decimation->Reset();
+
+        m_decimations.push_back(decimation);
+    }
+}
+
+_Use_decl_annotations_
+void PayloadHandler::RemoveDecimation(
+    std::shared_ptr<SubscriberDecimation> const& decimation)
+{
+    auto guard = m_cs.Guard();
+
+    m_decimations.erase(std::remove(m_decimations.begin(), m_decimations.end(), decimation), m_decimations.end());
+}
+
+_Use_decl_annotations_
+void PayloadHandler::ConfigureDecimation(
+    std::shared_ptr<SubscriberDecimation> const& decimation,
+    uint32_t frameInterval,
+    double targetFrameRate)
+{
+    NULL_CHK_R(decimation);
+
+    auto guard = m_cs.Guard();
+
+    decimation->Configure(frameInterval, targetFrameRate);
+}
+
+_Use_decl_annotations_
+bool PayloadHandler::IsAdmitted(
+    std::shared_ptr<SubscriberDecimation> const& decimation,
+    int64_t sampleTime)
+{
+    if (decimation == nullptr)
+    {
+        return true;
+    }
+
+    auto guard = m_cs.Guard();
+
+    return decimation->Take(sampleTime);
+}
+
+void PayloadHandler::SetRedundantFrameDetection(bool enable, float maxTranslation, float maxRotationDegrees, float maxLumaDifference, uint32_t maxRedundantFrames)
+{
+    auto guard = m_cs.Guard();
+
+    m_isRedundantDetectionEnabled = enable;
+    m_redundantThresholds = { maxTranslation, maxRotationDegrees, maxLumaDifference, maxRedundantFrames };
+
+    ++m_redundantSettingsVersion;
+}
+
 bool PayloadHandler::ProceesTranform(CameraCapture::Media::Payload const& payload)
 {
-    if (m_appCoordinateSystem != nullptr)
+    auto worldOrigin = m_appCoordinateSystem;
+    if (worldOrigin != nullptr)
     {
-        return m_transform.ProcessWorldTransform(payload, m_appCoordinateSystem);
+        return ProcessTransform(payload, worldOrigin);
     }
 
     return false;
 }
 
+void PayloadHandler::QueueTransform(CameraCapture::Media::Payload const& payload)
+{
+    auto worldOrigin = m_appCoordinateSystem;
+    if (payload == nullptr || worldOrigin == nullptr)
+    {
+        return;
+    }
+
+    UINT64 deviceTime = 0;
+    auto streamSample = payload.try_as<IStreamSample>();
+    auto hasDeviceTime = streamSample != nullptr && streamSample->Sample() != nullptr
+        && SUCCEEDED(streamSample->Sample()->GetUINT64(MFSampleExtension_DeviceTimestamp, &deviceTime));
+
+    auto guard = m_poseCs.Guard();
+
+    if (m_isShutdown)
+    {
+        return;
+    }
+
+    // already located by the redundant frame detection
+    if (hasDeviceTime && static_cast<int64_t>(deviceTime) == m_dispatchLocatedTime)
+    {
+        return;
+    }
+
+    // the worker fell behind, the oldest poses are the least useful
+    if (m_pendingPoses.size() >= MaxPendingPoses)
+    {
+        m_pendingPoses.pop_front();
+    }
+
+    m_pendingPoses.push_back({ payload, worldOrigin });
+
+    if (!m_isPoseDrainQueued)
+    {
+        if (m_poseExecutor == nullptr)
+        {
+            m_poseExecutor = WorkQueueExecutor::CreateSerial();
+        }
+
+        m_isPoseDrainQueued = m_poseExecutor->Post([weak = get_weak()]()
+        {
+            auto strong = weak.get();
+            if (strong != nullptr)
+            {
+                strong->ResolvePoses();
+            }
+        });
+    }
+}
+
+_Use_decl_annotations_
+hresult PayloadHandler::GetCameraCalibration(
+    CAMERA_CALIBRATION const** ppCalibration)
+{
+    auto calibrationPriv = m_transform.as<ICameraCalibrationPriv>();
+    NULL_CHK_HR(calibrationPriv, E_NOINTERFACE);
+
+    return calibrationPriv->GetCameraCalibration(ppCalibration);
+}
+
+bool PayloadHandler::TryGetCameraProjection(Windows::Foundation::Numerics::float4x4& projection)
+{
+    auto guard = m_poseCs.Guard();
+
+    projection = m_projection;
+
+    return m_hasProjection;
+}
+
+// pose worker, locates every frame queued since the last pass
+void PayloadHandler::ResolvePoses()
+{
+    std::deque<PoseRequest> requests;
+    {
+        auto guard = m_poseCs.Guard();
+
+        requests.swap(m_pendingPoses);
+
+        m_isPoseDrainQueued = false;
+    }
+
+    for (auto&& request : requests)
+    {
+        ProcessTransform(request.payload, request.worldOrigin);
+    }
+}
+
+_Use_decl_annotations_
+bool PayloadHandler::ProcessTransform(
+    CameraCapture::Media::Payload const& payload,
+    Windows::Perception::Spatial::SpatialCoordinateSystem const& worldOrigin)
+{
+    bool isLocated = false;
+    {
+        // the transform keeps per session state, one frame at a time
+        auto guard = m_transformCs.Guard();
+
+        isLocated = m_transform.ProcessWorldTransform(payload, worldOrigin);
+    }
+
+    if (isLocated)
+    {
+        auto guard = m_poseCs.Guard();
+
+        m_projection = payload.CameraProjection();
+        m_hasProjection = true;
+    }
+
+    return isLocated;
+}
+
+bool PayloadHandler::TryGetCameraToWorld(int64_t timestamp, Windows::Foundation::Numerics::float4x4& cameraToWorld)
+{
+    return m_transform.TryGetCameraToWorld(timestamp, cameraToWorld);
+}
+
+bool PayloadHandler::TryPredictCameraToWorld(int64_t targetTime, bool useAcceleration, Windows::Foundation::Numerics::float4x4& cameraToWorld)
+{
+    return m_transform.TryPredictCameraToWorld(targetTime, useAcceleration, cameraToWorld);
+}
+
 void PayloadHandler::Close()
 {
-    auto gurad = m_cs.Guard();
+    // shut down once the locks are released, an executor may wait for a running
+    // item that is blocked on one of them
+    std::shared_ptr<IExecutor> executor = nullptr;
+    std::shared_ptr<IExecutor> poseExecutor = nullptr;
+
+    {
+        auto gurad = m_cs.Guard();
+
+        m_isShutdown = true;
+
+        m_queue.Clear();
+
+        executor = m_executor;
+
+        // consumers drain what is buffered, then see the end of the stream
+        for (auto&& subscription : m_streams)
+        {
+            subscription.stream->Close();
+        }
+        m_streams.clear();
+        m_decimations.clear();
+
+        for (auto&& stream : m_avStreams)
+        {
+            stream->Close();
+        }
+        m_avStreams.clear();
+
+        // not shut down, that would discard the resumes just posted; the streams keep the
+        // executor alive until their consumers have seen the end
+        m_streamExecutor = nullptr;
+
+        auto guard = m_poseCs.Guard();
+
+        m_pendingPoses.clear();
 
-    m_isShutdown = true;
+        poseExecutor = m_poseExecutor;
+    }
+
+    if (executor != nullptr)
+    {
+        executor->Shutdown();
+    }
+
+    if (poseExecutor != nullptr)
+    {
+        poseExecutor->Shutdown();
+    }
 
     MFShutdown();
 }
 
 void PayloadHandler::QueueEncodingProfile(MediaEncodingProfile const& mediaProfile)
 {
-    QueueUnknown(winrt::get_unknown(mediaProfile));
+    QueueUnknown(winrt::get_unknown(mediaProfile), QueueLane::Control);
 }
 
 void PayloadHandler::QueueMetadata(MediaPropertySet const& metaData)
 {
-    QueueUnknown(winrt::get_unknown(metaData));
+    auto lane = QueueLane::Control;
+
+    if (metaData != nullptr && metaData.HasKey(MF_PAYLOAD_FLUSH))
+    {
+        auto gurad = m_cs.Guard();
+
+        // only a flush jumps the queue, markers stay behind the data queued before them
+        lane = QueueLane::Priority;
+
+        // anything still queued predates the flush
+        m_queue.DropData();
+
+        for (auto&& subscription : m_streams)
+        {
+            subscription.stream->Flush();
+        }
+
+        for (auto&& stream : m_avStreams)
+        {
+            stream->Flush();
+        }
+
+        for (auto&& decimation : m_decimations)
+        {
+            decimation->Reset();
+        }
+    }
+
+    QueueUnknown(winrt::get_unknown(metaData), lane);
 }
 
 void PayloadHandler::QueueEncodingProperties(Windows::Media::MediaProperties::IMediaEncodingProperties const& mediaDescription)
 {
-    QueueUnknown(winrt::get_unknown(mediaDescription));
+    QueueUnknown(winrt::get_unknown(mediaDescription), QueueLane::Control);
 }
 
 void PayloadHandler::QueuePayload(CameraCapture::Media::Payload const& payload)
 {
-    QueueUnknown(winrt::get_unknown(payload));
+    QueueUnknown(winrt::get_unknown(payload), QueueLane::Data);
+}
+
+bool PayloadHandler::ShouldQueueSample(guid const& majorType, int64_t sampleTime)
+{
+    // only video is decimated, audio blocks are never dropped
+    if (MFMediaType_Video != majorType)
+    {
+        return true;
+    }
+
+    auto guard = m_cs.Guard();
+
+    if (m_isShutdown)
+    {
+        return false;
+    }
+
+    // bundles need every frame to cover the audio between them
+    auto isAdmitted = m_decimations.empty()
+        || std::any_of(m_avStreams.begin(), m_avStreams.end(), [](auto const& stream) { return !stream->IsClosed(); });
+
+    // every decimation sees every sample, its pacing depends on them
+    for (auto&& decimation : m_decimations)
+    {
+        if (decimation->Admit(sampleTime))
+        {
+            isAdmitted = true;
+        }
+    }
+
+    return isAdmitted;
 }
 
 _Use_decl_annotations_
@@ -84,12 +542,13 @@ HRESULT PayloadHandler::QueueMFSample(
 
     payload.as<IStreamSample>()->Sample(majorType, type, sample);
     
-    return QueueUnknown(winrt::get_unknown(payload));
+    return QueueUnknown(winrt::get_unknown(payload), QueueLane::Data);
 }
 
 _Use_decl_annotations_
 HRESULT PayloadHandler::QueueUnknown(
-    IUnknown* pUnknown)
+    IUnknown* pUnknown,
+    QueueLane lane)
 {
     NULL_CHK_HR(pUnknown, S_OK);
 
@@ -100,52 +559,202 @@ HRESULT PayloadHandler::QueueUnknown(
         IFR(MF_E_SHUTDOWN);
     }
 
-    if (m_workItemQueueId == MFASYNC_CALLBACK_QUEUE_UNDEFINED)
+    if (m_executor == nullptr)
     {
         return S_OK;
     }
 
-    com_ptr<IMFAsyncResult> asyncResult = nullptr;
-    IFR(MFCreateAsyncResult(nullptr, this, pUnknown, asyncResult.put()));
+    com_ptr<::IUnknown> spUnknown = nullptr;
+    spUnknown.copy_from(pUnknown);
+
+    m_queue.Push(std::move(spUnknown), lane);
+
+    // each work item dispatches the entry that is next at the time it runs, a flush first
+    if (!PostDispatch())
+    {
+        IFR(MF_E_SHUTDOWN);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void PayloadHandler::Executor(
+    std::shared_ptr<IExecutor> const& executor)
+{
+    NULL_CHK_R(executor);
+
+    std::shared_ptr<IExecutor> previous = nullptr;
+
+    {
+        auto gurad = m_cs.Guard();
+
+        if (m_isShutdown)
+        {
+            return;
+        }
+
+        previous = m_executor;
+        m_executor = executor;
 
-    return MFPutWorkItemEx2(m_workItemQueueId, 0, asyncResult.detach());
+        // work posted to the previous executor is discarded with it, an item of it that
+        // is already running is serialized with the new ones by m_dispatchCs
+        for (size_t i = m_queue.ControlCount() + m_queue.DataCount(); i > 0; --i)
+        {
+            PostDispatch();
+        }
+    }
+
+    if (previous != nullptr)
+    {
+        previous->Shutdown();
+    }
 }
 
 _Use_decl_annotations_
-HRESULT PayloadHandler::GetParameters(
-    DWORD *pdwFlags,
-    DWORD *pdwQueue)
+std::shared_ptr<PayloadHandler::PayloadStream> PayloadHandler::Subscribe(
+    size_t capacity,
+    FrameStreamPolicy policy,
+    uint32_t frameInterval,
+    double targetFrameRate)
 {
     auto gurad = m_cs.Guard();
 
     if (m_isShutdown)
     {
-        IFR(MF_E_SHUTDOWN);
+        IFT(MF_E_SHUTDOWN);
     }
 
-    *pdwFlags = 0;
-    *pdwQueue = m_workItemQueueId;
+    // consumers are resumed on the shared MF queue, never on the serial dispatch queue
+    if (m_streamExecutor == nullptr)
+    {
+        m_streamExecutor = WorkQueueExecutor::CreateMultithreaded();
+    }
 
-    return S_OK;
+    auto stream = std::make_shared<PayloadStream>(capacity, policy, m_streamExecutor);
+    auto decimation = std::make_shared<SubscriberDecimation>(frameInterval, targetFrameRate);
+
+    m_streams.push_back({ stream, decimation });
+    m_decimations.push_back(decimation);
+
+    return stream;
 }
 
 _Use_decl_annotations_
-HRESULT PayloadHandler::Invoke(
-    IMFAsyncResult *pAsyncResult)
+std::shared_ptr<PayloadHandler::AvBundleStream> PayloadHandler::SubscribeAvBundles(
+    size_t capacity,
+    FrameStreamPolicy policy)
 {
+    auto gurad = m_cs.Guard();
+
     if (m_isShutdown)
     {
-        return S_OK;
+        IFT(MF_E_SHUTDOWN);
     }
 
-    // convert back to Payload
-    com_ptr<IUnknown> spState = nullptr;
-    spState.attach(pAsyncResult->GetStateNoAddRef());
+    if (m_streamExecutor == nullptr)
+    {
+        m_streamExecutor = WorkQueueExecutor::CreateMultithreaded();
+    }
+
+    auto stream = std::make_shared<AvBundleStream>(capacity, policy, m_streamExecutor);
+
+    m_avStreams.push_back(stream);
+
+    return stream;
+}
+
+_Use_decl_annotations_
+void PayloadHandler::MarkRedundantFrame(
+    CameraCapture::Media::Payload const& payload,
+    AvTimestamp const& time)
+{
+    {
+        auto gurad = m_cs.Guard();
+
+        if (m_appliedRedundantSettingsVersion != m_redundantSettingsVersion)
+        {
+            m_redundantFrames.Configure(m_isRedundantDetectionEnabled, m_redundantThresholds);
+
+            m_appliedRedundantSettingsVersion = m_redundantSettingsVersion;
+        }
+    }
+
+    bool isRedundant = false;
+    if (m_redundantFrames.IsEnabled())
+    {
+        // the pose worker only sees the frame after its subscribers, so it is located
+        // here, and QueueTransform skips it later; this puts TryLocateAtTimestamp back
+        // on the dispatch thread for every frame while detection is enabled
+        Windows::Foundation::Numerics::float4x4 cameraToWorld{};
+        auto hasPose = time.hasDeviceTime
+            && ProceesTranform(payload)
+            && m_transform.TryGetCameraToWorld(time.deviceTime, cameraToWorld);
+
+        if (hasPose)
+        {
+            auto guard = m_poseCs.Guard();
+
+            m_dispatchLocatedTime = time.deviceTime;
+        }
+
+        RedundantFrameDetector::LumaSamples luma{};
+        auto hasLuma = m_redundantFrames.UsesLuma() && SampleLuma(payload, luma);
+
+        isRedundant = m_redundantFrames.Process(hasPose ? &cameraToWorld.m11 : nullptr, hasLuma ? &luma : nullptr);
+    }
 
-    NULL_CHK_HR(spState, E_POINTER);
-        
-    hresult hr = S_OK;
+    // always written, the flags of a reused sample must not carry over
+    auto streamSample = payload.try_as<IStreamSample>();
+    if (streamSample != nullptr && streamSample->Sample() != nullptr)
+    {
+        streamSample->Sample()->SetUINT32(MF_PAYLOAD_FRAME_FLAGS, isRedundant ? static_cast<UINT32>(FrameFlags::Redundant) : 0);
+    }
+}
+
+bool PayloadHandler::PostDispatch()
+{
+    return m_executor->Post([weak = get_weak()]()
+    {
+        auto strong = weak.get();
+        if (strong != nullptr)
+        {
+            strong->DispatchNext();
+        }
+    });
+}
+
+void PayloadHandler::DispatchNext()
+{
+    // one entry at a time in queue order, even while an item of a replaced executor
+    // is still running next to the new one
+    auto dispatchGuard = m_dispatchCs.Guard();
+
+    com_ptr<::IUnknown> spState = nullptr;
+
+    {
+        auto gurad = m_cs.Guard();
+
+        if (m_isShutdown)
+        {
+            return;
+        }
 
+        // nothing left when the entry was dropped by a flush
+        if (!m_queue.Pop(spState))
+        {
+            return;
+        }
+    }
+
+    Dispatch(spState);
+}
+
+_Use_decl_annotations_
+void PayloadHandler::Dispatch(
+    com_ptr<::IUnknown> const& spState)
+{
+    // convert back to Payload
     auto payload = spState.try_as<CameraCapture::Media::Payload>();
     auto profile = spState.try_as<MediaEncodingProfile>();
     auto metaData = spState.try_as<MediaPropertySet>();
@@ -153,6 +762,10 @@ HRESULT PayloadHandler::Invoke(
     auto streamSample = spState.try_as<MediaStreamSample>();
     if (profile != nullptr)
     {
+        // a new session, without an audio stream frames are bundled on their own
+        m_avSync.Reset(profile.Audio() != nullptr);
+        m_redundantFrames.Reset();
+
         if (m_profileEvent)
         {
             m_profileEvent(*this, profile);
@@ -160,6 +773,23 @@ HRESULT PayloadHandler::Invoke(
     }
     else if (payload != nullptr)
     {
+        GUID majorType = GUID_NULL;
+        AvTimestamp time{};
+        auto isVideo = GetAvTimestamp(payload, majorType, time) && MFMediaType_Video == majorType;
+        if (isVideo)
+        {
+            if (time.hasDeviceTime)
+            {
+                FrameLatency::Instance()->Record(LatencyStage::Dequeue, time.deviceTime);
+            }
+
+            // before anyone sees the frame, subscribers read the flag off the sample
+            MarkRedundantFrame(payload, time);
+        }
+
+        PushToStreams(payload, isVideo, time.sampleTime);
+        PushToAvStreams(payload);
+
         if (m_payloadEvent)
         {
             m_payloadEvent(*this, payload);
@@ -167,6 +797,12 @@ HRESULT PayloadHandler::Invoke(
     } 
     else if (metaData != nullptr)
     {
+        if (metaData.HasKey(MF_PAYLOAD_FLUSH))
+        {
+            m_avSync.Reset(m_avSync.IsAudioExpected());
+            m_redundantFrames.Reset();
+        }
+
         if (m_metaDataEvent)
         {
             m_metaDataEvent(*this, metaData);
@@ -186,6 +822,112 @@ HRESULT PayloadHandler::Invoke(
             m_streamSampleEvent(*this, streamSample);
         }
     }
+}
+
+_Use_decl_annotations_
+void PayloadHandler::PushToStreams(
+    CameraCapture::Media::Payload const& payload,
+    bool isVideo,
+    int64_t sampleTime)
+{
+    std::vector<std::shared_ptr<PayloadStream>> streams;
+
+    {
+        auto gurad = m_cs.Guard();
+
+        // consumers unsubscribe by closing their stream
+        for (auto it = m_streams.begin(); it != m_streams.end();)
+        {
+            if (it->stream->IsClosed())
+            {
+                m_decimations.erase(std::remove(m_decimations.begin(), m_decimations.end(), it->decimation), m_decimations.end());
+
+                it = m_streams.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        // a frame may have been queued for another subscriber only
+        for (auto&& subscription : m_streams)
+        {
+            if (!isVideo || subscription.decimation->Take(sampleTime))
+            {
+                streams.push_back(subscription.stream);
+            }
+        }
+
+        if (streams.empty())
+        {
+            return;
+        }
+    }
 
-    return pAsyncResult->SetStatus(hr);
+    // push never blocks, a full stream applies its own policy
+    for (auto&& stream : streams)
+    {
+        stream->Push(payload);
+    }
+}
+
+_Use_decl_annotations_
+void PayloadHandler::PushToAvStreams(
+    CameraCapture::Media::Payload const& payload)
+{
+    std::vector<std::shared_ptr<AvBundleStream>> streams;
+
+    {
+        auto gurad = m_cs.Guard();
+
+        m_avStreams.erase(
+            std::remove_if(m_avStreams.begin(), m_avStreams.end(), [](auto const& stream) { return stream->IsClosed(); }),
+            m_avStreams.end());
+
+        streams = m_avStreams;
+    }
+
+    if (streams.empty())
+    {
+        m_isAvSyncActive = false;
+
+        return;
+    }
+
+    // frames held from an earlier subscription are stale
+    if (!m_isAvSyncActive)
+    {
+        m_avSync.Reset(m_avSync.IsAudioExpected());
+
+        m_isAvSyncActive = true;
+    }
+
+    GUID majorType = GUID_NULL;
+    AvTimestamp time{};
+    if (!GetAvTimestamp(payload, majorType, time))
+    {
+        return;
+    }
+
+    if (MFMediaType_Video == majorType)
+    {
+        m_avSync.PushVideo(payload, time);
+    }
+    else if (MFMediaType_Audio == majorType)
+    {
+        m_avSync.PushAudio(payload, time);
+    }
+    else
+    {
+        return;
+    }
+
+    m_avSync.Drain([&streams](AvBundle<CameraCapture::Media::Payload>&& bundle)
+    {
+        for (auto&& stream : streams)
+        {
+            stream->Push(bundle);
+        }
+    });
 }
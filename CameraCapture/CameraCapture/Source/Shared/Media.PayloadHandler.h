@@ -10,27 +10,45 @@
 #include <mferror.h>
 
 #include "Media.Transform.h"
+#include "Media.SampleDecimator.h"
+#include "Media.PayloadQueue.h"
+#include "Media.Executor.h"
+#include "Media.FrameStream.h"
+#include "Media.AvSync.h"
+#include "Media.RedundantFrameDetector.h"
 
 namespace winrt::CameraCapture::Media::implementation
 {
-    struct PayloadHandler : PayloadHandlerT<PayloadHandler, IMFAsyncCallback>
+    struct PayloadHandler : PayloadHandlerT<PayloadHandler, ICameraCalibrationPriv>
     {
         PayloadHandler();
         ~PayloadHandler() { Close(); }
 
         // PayloadHandler
         bool ProceesTranform(CameraCapture::Media::Payload const& payload);
+        bool TryGetCameraToWorld(int64_t timestamp, Windows::Foundation::Numerics::float4x4& cameraToWorld);
+        bool TryPredictCameraToWorld(int64_t targetTime, bool useAcceleration, Windows::Foundation::Numerics::float4x4& cameraToWorld);
+        void QueueTransform(CameraCapture::Media::Payload const& payload);
+        bool TryGetCameraProjection(Windows::Foundation::Numerics::float4x4& projection);
         Windows::Perception::Spatial::SpatialCoordinateSystem AppCoordinateSystem();
         void AppCoordinateSystem(Windows::Perception::Spatial::SpatialCoordinateSystem const& value);
 
+        // while enabled frames are located on the dispatch thread instead of the pose
+        // worker, the flag has to be set before the frame is delivered
+        void SetRedundantFrameDetection(bool enable, float maxTranslation, float maxRotationDegrees, float maxLumaDifference, uint32_t maxRedundantFrames);
+
         // IClosable
         void Close();
 
+        // ICameraCalibrationPriv, the calibration of the frames the transform last saw
+        virtual hresult __stdcall GetCameraCalibration(_Outptr_ CAMERA_CALIBRATION const** ppCalibration) override;
+
         // IPayloadHandler
         void QueueEncodingProfile(Windows::Media::MediaProperties::MediaEncodingProfile const& mediaProfile);
         void QueueMetadata(Windows::Media::MediaProperties::MediaPropertySet const& metaData);
         void QueueEncodingProperties(Windows::Media::MediaProperties::IMediaEncodingProperties const& mediaDescription);
         void QueuePayload(CameraCapture::Media::Payload const& payload);
+        bool ShouldQueueSample(guid const& majorType, int64_t sampleTime);
 
         winrt::event_token OnMediaProfile(Windows::Foundation::EventHandler<Windows::Media::MediaProperties::MediaEncodingProfile> const& handler)
         {
@@ -83,20 +101,96 @@ namespace winrt::CameraCapture::Media::implementation
             _In_ com_ptr<IMFMediaType> const& type,
             _In_ com_ptr<IMFSample> const& sample);
 
+        // control messages (markers, format changes) are dispatched in order with the data,
+        // a flush is dispatched ahead of both and drops the data queued before it
+        using QueueLane = PayloadQueue<com_ptr<::IUnknown>>::Lane;
+
         STDMETHODIMP QueueUnknown(
-            _In_ ::IUnknown* pUnknown);
+            _In_ ::IUnknown* pUnknown,
+            _In_ QueueLane lane);
+
+        // replaces the executor events are raised on, defaults to a serial MF work queue;
+        // events are only raised in order if the executor is serial
+        void Executor(
+            _In_ std::shared_ptr<IExecutor> const& executor);
+
+        // each subscriber decimates video on its own and a sample is only queued if at
+        // least one of them admits it; OnStreamPayload handlers that want fewer frames
+        // add a decimation and skip the payloads IsAdmitted rejects. Without any
+        // decimation added every sample is queued.
+        void AddDecimation(
+            _In_ std::shared_ptr<SubscriberDecimation> const& decimation);
+        void RemoveDecimation(
+            _In_ std::shared_ptr<SubscriberDecimation> const& decimation);
+        void ConfigureDecimation(
+            _In_ std::shared_ptr<SubscriberDecimation> const& decimation,
+            _In_ uint32_t frameInterval,
+            _In_ double targetFrameRate);
+        bool IsAdmitted(
+            _In_ std::shared_ptr<SubscriberDecimation> const& decimation,
+            _In_ int64_t sampleTime);
+
+        // pull based alternative to OnStreamPayload, each subscription buffers up to
+        // capacity payloads and resumes its consumer off the dispatch thread; video is
+        // decimated per subscription, every frameInterval-th frame or paced to
+        // targetFrameRate (0 for both delivers every frame); close the returned stream
+        // to unsubscribe
+        using PayloadStream = FrameStream<CameraCapture::Media::Payload>;
+
+        std::shared_ptr<PayloadStream> Subscribe(
+            _In_ size_t capacity,
+            _In_ FrameStreamPolicy policy,
+            _In_ uint32_t frameInterval = 0,
+            _In_ double targetFrameRate = 0.0);
+
+        // each video frame paired with the audio blocks captured during it, frames are
+        // held until the audio has caught up so bundles lag the video by about one
+        // audio block; bundles are only assembled while a subscription is open
+        using AvBundleStream = FrameStream<AvBundle<CameraCapture::Media::Payload>>;
+
+        std::shared_ptr<AvBundleStream> SubscribeAvBundles(
+            _In_ size_t capacity,
+            _In_ FrameStreamPolicy policy);
 
-        // IMFAsyncCallback
-        STDOVERRIDEMETHODIMP GetParameters(
-            __RPC__out DWORD *pdwFlags,
-            __RPC__out DWORD *pdwQueue);
-        STDOVERRIDEMETHODIMP Invoke(
-            __RPC__in_opt IMFAsyncResult *pAsyncResult);
+    private:
+        bool PostDispatch();
+        void DispatchNext();
+        void Dispatch(
+            _In_ com_ptr<::IUnknown> const& spState);
+        void PushToStreams(
+            _In_ CameraCapture::Media::Payload const& payload,
+            _In_ bool isVideo,
+            _In_ int64_t sampleTime);
+        void PushToAvStreams(
+            _In_ CameraCapture::Media::Payload const& payload);
+        bool ProcessTransform(
+            _In_ CameraCapture::Media::Payload const& payload,
+            _In_ Windows::Perception::Spatial::SpatialCoordinateSystem const& worldOrigin);
+        void ResolvePoses();
+        void MarkRedundantFrame(
+            _In_ CameraCapture::Media::Payload const& payload,
+            _In_ AvTimestamp const& time);
 
     private:
         CriticalSection m_cs;
         boolean m_isShutdown;
-        DWORD m_workItemQueueId;
+        std::shared_ptr<IExecutor> m_executor;
+        PayloadQueue<com_ptr<::IUnknown>> m_queue;
+        std::shared_ptr<IExecutor> m_streamExecutor;
+        struct PayloadSubscription
+        {
+            std::shared_ptr<PayloadStream> stream;
+            std::shared_ptr<SubscriberDecimation> decimation;
+        };
+
+        std::vector<PayloadSubscription> m_streams;
+        std::vector<std::shared_ptr<AvBundleStream>> m_avStreams;
+
+        // held for each dispatch, the AV synchronizer and redundant frame detector
+        // are only used under it
+        CriticalSection m_dispatchCs;
+        AvSynchronizer<CameraCapture::Media::Payload> m_avSync;
+        boolean m_isAvSyncActive;
         
         event<Windows::Foundation::EventHandler<Windows::Media::MediaProperties::MediaEncodingProfile>> m_profileEvent;
         event<Windows::Foundation::EventHandler<CameraCapture::Media::Payload>> m_payloadEvent;
@@ -104,8 +198,38 @@ namespace winrt::CameraCapture::Media::implementation
         event<Windows::Foundation::EventHandler<Windows::Media::MediaProperties::MediaPropertySet>> m_metaDataEvent;
         event<Windows::Foundation::EventHandler<Windows::Media::MediaProperties::IMediaEncodingProperties>> m_mediaDescriptionEvent;
 
+        // every subscriber's decimation, run for each video sample under m_cs
+        std::vector<std::shared_ptr<SubscriberDecimation>> m_decimations;
+
+        // settings are applied by the dispatch executor, which owns the detector
+        bool m_isRedundantDetectionEnabled;
+        RedundantFrameDetector::Thresholds m_redundantThresholds;
+        uint32_t m_redundantSettingsVersion;
+        uint32_t m_appliedRedundantSettingsVersion;
+        RedundantFrameDetector m_redundantFrames;
+
         CameraCapture::Media::Transform m_transform;
         Windows::Perception::Spatial::SpatialCoordinateSystem m_appCoordinateSystem;
+
+        // locate requests waiting for the pose worker, drained as one batch
+        struct PoseRequest
+        {
+            CameraCapture::Media::Payload payload;
+            Windows::Perception::Spatial::SpatialCoordinateSystem worldOrigin;
+        };
+
+        static constexpr size_t MaxPendingPoses = 8;
+
+        CriticalSection m_transformCs;
+        CriticalSection m_poseCs;
+        std::shared_ptr<IExecutor> m_poseExecutor;
+        std::deque<PoseRequest> m_pendingPoses;
+        boolean m_isPoseDrainQueued;
+        boolean m_hasProjection;
+        Windows::Foundation::Numerics::float4x4 m_projection;
+
+        // device time of the last frame MarkRedundantFrame located, under m_poseCs
+        int64_t m_dispatchLocatedTime;
     };
 }
 
@@ -0,0 +1,106 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <utility>
+
+// FIFO used by the payload handler. Data and control entries (markers, format
+// changes) keep the order they were pushed in, so a format change or end of
+// stream is never seen before the data queued ahead of it. Only priority
+// entries (flushes) jump the queue, and the data they make obsolete can be
+// dropped while the control entries between it stay. The priority lane is for
+// flushes only: an end of stream marker waits behind the frames queued before
+// it, so a stop without a flush is not delivered any sooner than the data.
+// Not thread safe, callers lock.
+template <typename T>
+struct PayloadQueue
+{
+    enum class Lane
+    {
+        Data,
+        Control,
+        Priority
+    };
+
+    void Push(T&& entry, Lane lane)
+    {
+        if (lane == Lane::Priority)
+        {
+            m_priority.emplace_back(std::move(entry));
+        }
+        else
+        {
+            m_ordered.push_back({ std::move(entry), lane == Lane::Data });
+
+            if (lane == Lane::Data)
+            {
+                ++m_dataCount;
+            }
+        }
+    }
+
+    bool Pop(T& entry)
+    {
+        if (!m_priority.empty())
+        {
+            entry = std::move(m_priority.front());
+            m_priority.pop_front();
+
+            return true;
+        }
+
+        if (m_ordered.empty())
+        {
+            return false;
+        }
+
+        if (m_ordered.front().isData)
+        {
+            --m_dataCount;
+        }
+
+        entry = std::move(m_ordered.front().entry);
+        m_ordered.pop_front();
+
+        return true;
+    }
+
+    // control entries queued between the data stay in order
+    size_t DropData()
+    {
+        auto dropped = m_dataCount;
+
+        for (auto it = m_ordered.begin(); it != m_ordered.end();)
+        {
+            it = it->isData ? m_ordered.erase(it) : it + 1;
+        }
+
+        m_dataCount = 0;
+
+        return dropped;
+    }
+
+    void Clear()
+    {
+        m_priority.clear();
+        m_ordered.clear();
+        m_dataCount = 0;
+    }
+
+    size_t ControlCount() const { return m_priority.size() + m_ordered.size() - m_dataCount; }
+    size_t DataCount() const { return m_dataCount; }
+
+private:
+    struct Entry
+    {
+        T entry;
+        bool isData;
+    };
+
+    std::deque<T> m_priority;
+    std::deque<Entry> m_ordered;
+    size_t m_dataCount = 0;
+};
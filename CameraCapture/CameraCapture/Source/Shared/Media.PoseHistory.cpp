@@ -0,0 +1,294 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "Media.PoseHistory.h"
+
+#include <cmath>
+
+using namespace winrt;
+using namespace Windows::Foundation::Numerics;
+
+// axis * angle of a rotation, the shorter way round
+static float3 ToRotationVector(quaternion const& rotation)
+{
+    auto sign = rotation.w < 0.0f ? -1.0f : 1.0f;
+
+    float3 axis{ rotation.x * sign, rotation.y * sign, rotation.z * sign };
+
+    auto sinHalfAngle = length(axis);
+    if (sinHalfAngle < 1e-6f)
+    {
+        return axis * 2.0f;
+    }
+
+    auto angle = 2.0f * std::atan2(sinHalfAngle, rotation.w * sign);
+
+    return axis * (angle / sinHalfAngle);
+}
+
+static quaternion FromRotationVector(float3 const& rotation)
+{
+    auto angle = length(rotation);
+    if (angle < 1e-6f)
+    {
+        return normalize(quaternion{ rotation.x * 0.5f, rotation.y * 0.5f, rotation.z * 0.5f, 1.0f });
+    }
+
+    return make_quaternion_from_axis_angle(rotation / angle, angle);
+}
+
+PoseHistory::PoseHistory()
+    : m_poses{}
+    , m_start(0)
+    , m_count(0)
+{
+}
+
+void PoseHistory::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_start = 0;
+    m_count = 0;
+}
+
+_Use_decl_annotations_
+void PoseHistory::Add(
+    int64_t timestamp,
+    float4x4 const& cameraToWorld)
+{
+    // camera to world is rigid, the scale is dropped
+    float3 scale{};
+    Pose pose{ timestamp, quaternion::identity(), float3::zero() };
+    if (!decompose(cameraToWorld, &scale, &pose.orientation, &pose.position))
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_count > 0)
+    {
+        auto const& newest = At(m_count - 1);
+        if (timestamp < newest.timestamp)
+        {
+            m_start = 0;
+            m_count = 0;
+        }
+        else if (timestamp == newest.timestamp)
+        {
+            m_poses[(m_start + m_count - 1) % Capacity] = pose;
+
+            return;
+        }
+    }
+
+    if (m_count < Capacity)
+    {
+        m_poses[(m_start + m_count) % Capacity] = pose;
+        ++m_count;
+    }
+    else
+    {
+        m_poses[m_start] = pose;
+        m_start = (m_start + 1) % Capacity;
+    }
+}
+
+_Use_decl_annotations_
+bool PoseHistory::TryGetPose(
+    int64_t timestamp,
+    Pose& pose) const
+{
+    pose = Pose{ timestamp, quaternion::identity(), float3::zero() };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return InterpolateLocked(timestamp, pose);
+}
+
+_Use_decl_annotations_
+bool PoseHistory::InterpolateLocked(
+    int64_t timestamp,
+    Pose& pose) const
+{
+    if (m_count == 0 || timestamp < At(0).timestamp || timestamp > At(m_count - 1).timestamp)
+    {
+        return false;
+    }
+
+    // first pose at or after the timestamp
+    size_t low = 0;
+    size_t high = m_count - 1;
+    while (low < high)
+    {
+        auto middle = low + (high - low) / 2;
+        if (At(middle).timestamp < timestamp)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    auto const& after = At(low);
+    if (after.timestamp == timestamp || low == 0)
+    {
+        pose.orientation = after.orientation;
+        pose.position = after.position;
+
+        return true;
+    }
+
+    auto const& before = At(low - 1);
+
+    auto amount = static_cast<float>(static_cast<double>(timestamp - before.timestamp) / static_cast<double>(after.timestamp - before.timestamp));
+
+    pose.orientation = slerp(before.orientation, after.orientation, amount);
+    pose.position = lerp(before.position, after.position, amount);
+
+    return true;
+}
+
+_Use_decl_annotations_
+bool PoseHistory::TryGetCameraToWorld(
+    int64_t timestamp,
+    float4x4& cameraToWorld) const
+{
+    cameraToWorld = float4x4::identity();
+
+    Pose pose{};
+    if (!TryGetPose(timestamp, pose))
+    {
+        return false;
+    }
+
+    // same composition as the located transform, rotation then translation
+    cameraToWorld = make_float4x4_from_quaternion(pose.orientation) * make_float4x4_translation(pose.position);
+
+    return true;
+}
+
+_Use_decl_annotations_
+bool PoseHistory::TryPredictPose(
+    int64_t targetTime,
+    bool useAcceleration,
+    Pose& pose) const
+{
+    pose = Pose{ targetTime, quaternion::identity(), float3::zero() };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_count == 0)
+    {
+        return false;
+    }
+
+    auto const& newest = At(m_count - 1);
+    if (targetTime <= newest.timestamp)
+    {
+        return InterpolateLocked(targetTime, pose);
+    }
+
+    pose.orientation = newest.orientation;
+    pose.position = newest.position;
+
+    // the acceleration needs two windows of history
+    auto window = newest.timestamp - At(0).timestamp;
+    if (useAcceleration)
+    {
+        window /= 2;
+    }
+    if (window > VelocityWindow)
+    {
+        window = VelocityWindow;
+    }
+    if (window <= 0)
+    {
+        // a single pose, hold it
+        return true;
+    }
+
+    auto seconds = static_cast<float>(window) / 10000000.0f;
+
+    Pose middle{};
+    InterpolateLocked(newest.timestamp - window, middle);
+
+    // rotations are measured in world space, newest = delta * older
+    auto velocity = (newest.position - middle.position) / seconds;
+    auto angularVelocity = ToRotationVector(newest.orientation * inverse(middle.orientation)) / seconds;
+    auto acceleration = float3::zero();
+    auto angularAcceleration = float3::zero();
+
+    if (useAcceleration)
+    {
+        Pose oldest{};
+        InterpolateLocked(newest.timestamp - 2 * window, oldest);
+
+        auto previousVelocity = (middle.position - oldest.position) / seconds;
+        auto previousAngularVelocity = ToRotationVector(middle.orientation * inverse(oldest.orientation)) / seconds;
+
+        acceleration = (velocity - previousVelocity) / seconds;
+        angularAcceleration = (angularVelocity - previousAngularVelocity) / seconds;
+
+        // the velocities are averages over their window, move them up to the newest pose
+        velocity += acceleration * (seconds * 0.5f);
+        angularVelocity += angularAcceleration * (seconds * 0.5f);
+    }
+
+    auto ahead = targetTime - newest.timestamp;
+    if (ahead > MaxPredictionTime)
+    {
+        ahead = MaxPredictionTime;
+    }
+
+    auto dt = static_cast<float>(ahead) / 10000000.0f;
+
+    pose.position = newest.position + velocity * dt + acceleration * (0.5f * dt * dt);
+    pose.orientation = normalize(FromRotationVector(angularVelocity * dt + angularAcceleration * (0.5f * dt * dt)) * newest.orientation);
+
+    return true;
+}
+
+_Use_decl_annotations_
+bool PoseHistory::TryPredictCameraToWorld(
+    int64_t targetTime,
+    bool useAcceleration,
+    float4x4& cameraToWorld) const
+{
+    cameraToWorld = float4x4::identity();
+
+    Pose pose{};
+    if (!TryPredictPose(targetTime, useAcceleration, pose))
+    {
+        return false;
+    }
+
+    cameraToWorld = make_float4x4_from_quaternion(pose.orientation) * make_float4x4_translation(pose.position);
+
+    return true;
+}
+
+_Use_decl_annotations_
+bool PoseHistory::TryGetWindow(
+    int64_t& oldest,
+    int64_t& newest) const
+{
+    oldest = 0;
+    newest = 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_count == 0)
+    {
+        return false;
+    }
+
+    oldest = At(0).timestamp;
+    newest = At(m_count - 1).timestamp;
+
+    return true;
+}
@@ -0,0 +1,82 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <winrt/windows.foundation.numerics.h>
+
+#include <array>
+#include <mutex>
+
+// Ring of the most recent camera to world poses, keyed by the QPC time in 100ns
+// units the frame was captured at. Added to by the payload thread as frames are
+// located and read from any thread. A query between two poses interpolates them,
+// slerp for the orientation and lerp for the position; a query outside the
+// window fails rather than extrapolate. Prediction past the newest pose is a
+// separate, explicit query.
+class PoseHistory
+{
+public:
+    static constexpr size_t Capacity = 64;  // about two seconds of 30fps video
+    static constexpr int64_t VelocityWindow = 1000000;      // 100ms the motion is measured over
+    static constexpr int64_t MaxPredictionTime = 2000000;   // predictions stop 200ms past the newest pose
+
+    struct Pose
+    {
+        int64_t timestamp;
+        winrt::Windows::Foundation::Numerics::quaternion orientation;
+        winrt::Windows::Foundation::Numerics::float3 position;
+    };
+
+    PoseHistory();
+
+    void Clear();
+
+    // a pose older than the newest one restarts the history, an equal one replaces it
+    void Add(
+        _In_ int64_t timestamp,
+        _In_ winrt::Windows::Foundation::Numerics::float4x4 const& cameraToWorld);
+
+    bool TryGetPose(
+        _In_ int64_t timestamp,
+        _Out_ Pose& pose) const;
+
+    bool TryGetCameraToWorld(
+        _In_ int64_t timestamp,
+        _Out_ winrt::Windows::Foundation::Numerics::float4x4& cameraToWorld) const;
+
+    // extrapolates the newest pose to a later time with the linear and angular
+    // velocity, and optionally acceleration, measured over the last VelocityWindow;
+    // a time inside the window is interpolated as above
+    bool TryPredictPose(
+        _In_ int64_t targetTime,
+        _In_ bool useAcceleration,
+        _Out_ Pose& pose) const;
+
+    bool TryPredictCameraToWorld(
+        _In_ int64_t targetTime,
+        _In_ bool useAcceleration,
+        _Out_ winrt::Windows::Foundation::Numerics::float4x4& cameraToWorld) const;
+
+    // the times a query can be answered for, false while empty
+    bool TryGetWindow(
+        _Out_ int64_t& oldest,
+        _Out_ int64_t& newest) const;
+
+private:
+    bool InterpolateLocked(
+        _In_ int64_t timestamp,
+        _Out_ Pose& pose) const;
+
+    Pose const& At(
+        _In_ size_t index) const
+    {
+        return m_poses[(m_start + index) % Capacity];
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::array<Pose, Capacity> m_poses;
+    size_t m_start;
+    size_t m_count;
+};
@@ -0,0 +1,228 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "Media.Prewarm.h"
+#include "Media.Functions.h"
+#include "Media.DeviceCatalog.h"
+
+#include <winrt/windows.media.capture.h>
+
+using namespace winrt;
+using namespace Windows::Devices::Enumeration;
+using namespace Windows::Media::Capture;
+
+std::shared_ptr<Prewarmer> Prewarmer::Instance()
+{
+    static std::shared_ptr<Prewarmer> s_instance = std::make_shared<Prewarmer>();
+
+    return s_instance;
+}
+
+Prewarmer::Prewarmer()
+    : m_state(State::Idle)
+    , m_isMFStarted(false)
+    , m_adapterLuid{}
+    , m_mediaDevice(nullptr)
+    , m_dxgiDeviceManager(nullptr)
+    , m_resetToken(0)
+{
+}
+
+Prewarmer::~Prewarmer()
+{
+    Release();
+}
+
+_Use_decl_annotations_
+void Prewarmer::Start(
+    IDXGIAdapter* pAdapter)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_state != State::Idle)
+    {
+        return;
+    }
+
+    m_state = State::Running;
+    m_adapterLuid = AdapterLuid(pAdapter);
+
+    com_ptr<IDXGIAdapter> adapter = nullptr;
+    adapter.copy_from(pAdapter);
+
+    m_thread = std::thread([this, adapter]()
+    {
+        Run(adapter);
+    });
+}
+
+void Prewarmer::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_completed.wait(lock, [this]() { return m_state != State::Running; });
+}
+
+_Use_decl_annotations_
+bool Prewarmer::TakeMediaDevice(
+    IDXGIAdapter* pAdapter,
+    com_ptr<ID3D11Device>& mediaDevice,
+    com_ptr<IMFDXGIDeviceManager>& dxgiDeviceManager,
+    uint32_t& resetToken)
+{
+    mediaDevice = nullptr;
+    dxgiDeviceManager = nullptr;
+    resetToken = 0;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_completed.wait(lock, [this]() { return m_state != State::Running; });
+
+    if (m_mediaDevice == nullptr || m_dxgiDeviceManager == nullptr)
+    {
+        return false;
+    }
+
+    auto adapterLuid = AdapterLuid(pAdapter);
+    if (adapterLuid.LowPart != m_adapterLuid.LowPart || adapterLuid.HighPart != m_adapterLuid.HighPart)
+    {
+        Log(L"Prewarmed media device is on a different adapter\n");
+
+        return false;
+    }
+
+    mediaDevice = std::move(m_mediaDevice);
+    dxgiDeviceManager = std::move(m_dxgiDeviceManager);
+    resetToken = m_resetToken;
+
+    m_mediaDevice = nullptr;
+    m_dxgiDeviceManager = nullptr;
+    m_resetToken = 0;
+
+    return true;
+}
+
+void Prewarmer::Release()
+{
+    std::thread thread;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        thread = std::move(m_thread);
+    }
+
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_mediaDevice = nullptr;
+    m_dxgiDeviceManager = nullptr;
+    m_resetToken = 0;
+    m_adapterLuid = {};
+
+    // balances the MFStartup in Run
+    if (m_isMFStarted)
+    {
+        MFShutdown();
+
+        m_isMFStarted = false;
+    }
+
+    m_state = State::Idle;
+}
+
+// private
+_Use_decl_annotations_
+void Prewarmer::Run(
+    com_ptr<IDXGIAdapter> const& adapter)
+{
+    winrt::init_apartment(winrt::apartment_type::multi_threaded);
+
+    auto isMFStarted = SUCCEEDED(MFStartup(MF_VERSION));
+
+    com_ptr<ID3D11Device> mediaDevice = nullptr;
+    com_ptr<IMFDXGIDeviceManager> dxgiDeviceManager = nullptr;
+    uint32_t resetToken = 0;
+
+    HRESULT hr = CreateMediaDeviceManager(adapter.get(), mediaDevice, dxgiDeviceManager, resetToken);
+    if (FAILED(hr))
+    {
+        Log(L"Prewarm could not create the media device: 0x%lx\n", hr);
+    }
+
+    try
+    {
+        // loads the capture components, C++/WinRT caches the factory
+        auto initSettings = MediaCaptureInitializationSettings();
+        get_activation_factory<MediaCapture>();
+
+        // fills the device catalog, profile support is queried once per device
+        auto catalog = DeviceCatalog::Instance();
+
+        auto videoDevice = catalog->GetFirstDeviceAsync(DeviceClass::VideoCapture).get();
+        if (videoDevice != nullptr)
+        {
+            catalog->IsVideoProfileSupported(videoDevice.Id());
+        }
+    }
+    catch (hresult_error const& e)
+    {
+        Log(L"Prewarm failed: %s\n", e.message().c_str());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_isMFStarted = isMFStarted;
+        m_mediaDevice = mediaDevice;
+        m_dxgiDeviceManager = dxgiDeviceManager;
+        m_resetToken = resetToken;
+
+        m_state = State::Completed;
+    }
+
+    m_completed.notify_all();
+
+    winrt::uninit_apartment();
+}
+
+_Use_decl_annotations_
+HRESULT Prewarmer::CreateMediaDeviceManager(
+    IDXGIAdapter* pAdapter,
+    com_ptr<ID3D11Device>& mediaDevice,
+    com_ptr<IMFDXGIDeviceManager>& dxgiDeviceManager,
+    uint32_t& resetToken)
+{
+    com_ptr<ID3D11Device> device = nullptr;
+    IFR(CreateMediaDevice(pAdapter, device.put()));
+
+    uint32_t token = 0;
+    com_ptr<IMFDXGIDeviceManager> deviceManager = nullptr;
+    IFR(MFCreateDXGIDeviceManager(&token, deviceManager.put()));
+
+    IFR(deviceManager->ResetDevice(device.get(), token));
+
+    mediaDevice = device;
+    dxgiDeviceManager = deviceManager;
+    resetToken = token;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+LUID Prewarmer::AdapterLuid(
+    IDXGIAdapter* pAdapter)
+{
+    DXGI_ADAPTER_DESC desc{};
+    if (pAdapter != nullptr && SUCCEEDED(pAdapter->GetDesc(&desc)))
+    {
+        return desc.AdapterLuid;
+    }
+
+    return {};
+}
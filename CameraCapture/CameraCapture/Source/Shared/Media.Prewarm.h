@@ -0,0 +1,80 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <d3d11.h>
+#include <dxgi.h>
+#include <mfapi.h>
+
+// Does the one time start up work of the first capture on a background thread:
+// Media Foundation start up, the media D3D device and its DXGI device manager,
+// activation of the WinRT capture classes and the capture device lookup. Started
+// from UnityPluginLoad or the Prewarm export; the first capture on the same
+// adapter takes over the prewarmed device instead of creating its own.
+//
+// The work only runs on its own MTA thread and never waits on the caller, so a
+// capture that arrives while it is running can safely block until it is done.
+class Prewarmer
+{
+public:
+    static std::shared_ptr<Prewarmer> Instance();
+
+    Prewarmer();
+    ~Prewarmer();
+
+    // does nothing if a prewarm is running or has completed since the last Release
+    void Start(
+        _In_opt_ IDXGIAdapter* pAdapter);
+
+    // blocks until a running prewarm has finished, returns right away if none is
+    void Wait();
+
+    // hands the prewarmed device to the caller once, false if there is none or it
+    // was created on a different adapter
+    bool TakeMediaDevice(
+        _In_opt_ IDXGIAdapter* pAdapter,
+        _Out_ winrt::com_ptr<ID3D11Device>& mediaDevice,
+        _Out_ winrt::com_ptr<IMFDXGIDeviceManager>& dxgiDeviceManager,
+        _Out_ uint32_t& resetToken);
+
+    // waits for a running prewarm and drops whatever was not taken
+    void Release();
+
+private:
+    enum class State
+    {
+        Idle,
+        Running,
+        Completed
+    };
+
+    void Run(
+        _In_ winrt::com_ptr<IDXGIAdapter> const& adapter);
+
+    static HRESULT CreateMediaDeviceManager(
+        _In_opt_ IDXGIAdapter* pAdapter,
+        _Out_ winrt::com_ptr<ID3D11Device>& mediaDevice,
+        _Out_ winrt::com_ptr<IMFDXGIDeviceManager>& dxgiDeviceManager,
+        _Out_ uint32_t& resetToken);
+
+    static LUID AdapterLuid(
+        _In_opt_ IDXGIAdapter* pAdapter);
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_completed;
+    State m_state;
+    std::thread m_thread;
+
+    bool m_isMFStarted;
+    LUID m_adapterLuid;
+    winrt::com_ptr<ID3D11Device> m_mediaDevice;
+    winrt::com_ptr<IMFDXGIDeviceManager> m_dxgiDeviceManager;
+    uint32_t m_resetToken;
+};
@@ -0,0 +1,174 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Marks video frames that barely differ from the last frame that was not marked,
+// the reference, so consumers can skip expensive work on them. A frame is redundant
+// when the camera moved less than the translation and rotation thresholds since
+// the reference and, with a luma threshold set, the mean absolute difference of a
+// sparse grid of luma samples stays under it. Without a pose only the luma check
+// can mark a frame, without either nothing is marked. After maxRedundantFrames in
+// a row the next frame becomes the reference so slow changes are not missed.
+//
+// Poses are row major rigid camera to world transforms (16 floats), the layout of
+// Windows::Foundation::Numerics::float4x4. Not thread safe.
+class RedundantFrameDetector
+{
+public:
+    static constexpr size_t LumaGridWidth = 16;
+    static constexpr size_t LumaGridHeight = 9;
+
+    using LumaSamples = std::array<uint8_t, LumaGridWidth * LumaGridHeight>;
+
+    struct Thresholds
+    {
+        float maxTranslation;           // meters
+        float maxRotationDegrees;
+        float maxLumaDifference;        // 0 to 255, 0 disables the luma check
+        uint32_t maxRedundantFrames;    // 0 for no limit
+    };
+
+    RedundantFrameDetector()
+        : m_isEnabled(false)
+        , m_thresholds{ 0.0f, 0.0f, 0.0f, 0 }
+        , m_minRotationCos(1.0f)
+        , m_hasReference(false)
+        , m_referenceHasPose(false)
+        , m_referenceHasLuma(false)
+        , m_referencePose{}
+        , m_referenceLuma{}
+        , m_redundantCount(0)
+    {
+    }
+
+    void Configure(bool enable, Thresholds const& thresholds)
+    {
+        m_isEnabled = enable;
+        m_thresholds = thresholds;
+
+        auto radians = thresholds.maxRotationDegrees * 3.14159265f / 180.0f;
+        m_minRotationCos = radians > 0.0f ? std::cos(radians) : 1.0f;
+
+        Reset();
+    }
+
+    bool IsEnabled() const { return m_isEnabled; }
+
+    // luma is only worth sampling when it is compared
+    bool UsesLuma() const { return m_isEnabled && m_thresholds.maxLumaDifference > 0.0f; }
+
+    // the next frame becomes the reference
+    void Reset()
+    {
+        m_hasReference = false;
+        m_redundantCount = 0;
+    }
+
+    // cameraToWorld and luma are nullptr if unknown for the frame
+    bool Process(float const* cameraToWorld, LumaSamples const* luma)
+    {
+        if (!m_isEnabled)
+        {
+            return false;
+        }
+
+        auto isRedundant = m_hasReference
+            && (m_thresholds.maxRedundantFrames == 0 || m_redundantCount < m_thresholds.maxRedundantFrames);
+
+        if (isRedundant)
+        {
+            if (cameraToWorld != nullptr && m_referenceHasPose)
+            {
+                isRedundant = IsPoseClose(cameraToWorld);
+            }
+            else
+            {
+                // the camera may have moved, only the image can tell
+                isRedundant = UsesLuma();
+            }
+        }
+
+        if (isRedundant && UsesLuma())
+        {
+            isRedundant = luma != nullptr && m_referenceHasLuma && LumaDifference(*luma) <= m_thresholds.maxLumaDifference;
+        }
+
+        if (isRedundant)
+        {
+            ++m_redundantCount;
+
+            return true;
+        }
+
+        m_hasReference = true;
+        m_redundantCount = 0;
+
+        m_referenceHasPose = cameraToWorld != nullptr;
+        if (m_referenceHasPose)
+        {
+            memcpy(m_referencePose, cameraToWorld, sizeof(m_referencePose));
+        }
+
+        m_referenceHasLuma = luma != nullptr;
+        if (m_referenceHasLuma)
+        {
+            m_referenceLuma = *luma;
+        }
+
+        return false;
+    }
+
+private:
+    bool IsPoseClose(float const* pose) const
+    {
+        auto dx = pose[12] - m_referencePose[12];
+        auto dy = pose[13] - m_referencePose[13];
+        auto dz = pose[14] - m_referencePose[14];
+        if (dx * dx + dy * dy + dz * dz > m_thresholds.maxTranslation * m_thresholds.maxTranslation)
+        {
+            return false;
+        }
+
+        // the trace of the relative rotation is the dot product of the two rotations
+        auto trace = 0.0f;
+        for (size_t row = 0; row < 3; ++row)
+        {
+            for (size_t column = 0; column < 3; ++column)
+            {
+                trace += pose[row * 4 + column] * m_referencePose[row * 4 + column];
+            }
+        }
+
+        return (trace - 1.0f) * 0.5f >= m_minRotationCos;
+    }
+
+    float LumaDifference(LumaSamples const& luma) const
+    {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < luma.size(); ++i)
+        {
+            sum += luma[i] > m_referenceLuma[i] ? luma[i] - m_referenceLuma[i] : m_referenceLuma[i] - luma[i];
+        }
+
+        return static_cast<float>(sum) / static_cast<float>(luma.size());
+    }
+
+private:
+    bool m_isEnabled;
+    Thresholds m_thresholds;
+    float m_minRotationCos;
+
+    bool m_hasReference;
+    bool m_referenceHasPose;
+    bool m_referenceHasLuma;
+    float m_referencePose[16];
+    LumaSamples m_referenceLuma;
+    uint32_t m_redundantCount;
+};
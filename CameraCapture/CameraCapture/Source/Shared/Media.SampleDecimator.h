@@ -0,0 +1,196 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Decides which samples of a stream are forwarded to a subscriber, either by
+// keeping every Nth sample or by pacing samples to a target frame rate based
+// on their timestamps (100ns units). Runs before any payload is allocated.
+struct SampleDecimator
+{
+    static constexpr int64_t TicksPerSecond = 10000000;
+
+    SampleDecimator()
+        : m_frameInterval(1)
+        , m_targetPeriod(0)
+        , m_frameCount(0)
+        , m_nextSampleTime(-1)
+        , m_lastSampleTime(-1)
+        , m_sourcePeriod(0)
+    {
+    }
+
+    // keep one out of every frameInterval samples, 0 or 1 disables
+    void FrameInterval(uint32_t frameInterval)
+    {
+        m_frameInterval = frameInterval > 1 ? frameInterval : 1;
+
+        Reset();
+    }
+    uint32_t FrameInterval() const { return m_frameInterval; }
+
+    // pace samples to the target rate, 0 disables
+    void TargetFrameRate(double framesPerSecond)
+    {
+        m_targetPeriod = framesPerSecond > 0.0 ? static_cast<int64_t>(TicksPerSecond / framesPerSecond) : 0;
+
+        Reset();
+    }
+    double TargetFrameRate() const
+    {
+        return m_targetPeriod > 0 ? static_cast<double>(TicksPerSecond) / m_targetPeriod : 0.0;
+    }
+
+    bool IsEnabled() const
+    {
+        return m_frameInterval > 1 || m_targetPeriod > 0;
+    }
+
+    void Reset()
+    {
+        m_frameCount = 0;
+        m_nextSampleTime = -1;
+        m_lastSampleTime = -1;
+        m_sourcePeriod = 0;
+    }
+
+    bool ShouldDeliver(int64_t sampleTime)
+    {
+        if (!IsEnabled())
+        {
+            return true;
+        }
+
+        // timestamps went backwards, stream was restarted
+        if (m_lastSampleTime >= 0 && sampleTime <= m_lastSampleTime)
+        {
+            Reset();
+        }
+
+        if (m_lastSampleTime >= 0)
+        {
+            m_sourcePeriod = sampleTime - m_lastSampleTime;
+        }
+        m_lastSampleTime = sampleTime;
+
+        if (m_frameInterval > 1)
+        {
+            if ((m_frameCount++ % m_frameInterval) != 0)
+            {
+                return false;
+            }
+        }
+
+        if (m_targetPeriod > 0)
+        {
+            // accept a sample that lands within half a source frame of the
+            // deadline, otherwise jitter would skip a whole frame
+            if (m_nextSampleTime >= 0 && sampleTime + (m_sourcePeriod / 2) < m_nextSampleTime)
+            {
+                return false;
+            }
+
+            // advance from the deadline so the output rate does not drift,
+            // unless we fell behind by more than a period
+            m_nextSampleTime = (m_nextSampleTime < 0 || sampleTime - m_nextSampleTime >= m_targetPeriod)
+                ? sampleTime + m_targetPeriod
+                : m_nextSampleTime + m_targetPeriod;
+        }
+
+        return true;
+    }
+
+private:
+    uint32_t m_frameInterval;
+    int64_t m_targetPeriod;
+    uint64_t m_frameCount;
+    int64_t m_nextSampleTime;
+    int64_t m_lastSampleTime;
+    int64_t m_sourcePeriod;
+};
+
+// One subscriber's decimation. Admit runs for every sample before a payload is
+// created, so a sample no subscriber admits is never queued; Take is asked once
+// the payload reaches the subscriber and only passes the samples it admitted.
+// Samples are matched on their time, admitted samples that never arrive (a flush
+// dropped them) age out. Not thread safe, callers lock.
+class SubscriberDecimation
+{
+public:
+    static constexpr size_t MaxAdmitted = 64;
+
+    SubscriberDecimation(uint32_t frameInterval, double targetFrameRate)
+    {
+        Configure(frameInterval, targetFrameRate);
+    }
+
+    void Configure(uint32_t frameInterval, double targetFrameRate)
+    {
+        m_decimator.FrameInterval(frameInterval);
+        m_decimator.TargetFrameRate(targetFrameRate);
+
+        m_admitted.clear();
+    }
+
+    uint32_t FrameInterval() const { return m_decimator.FrameInterval(); }
+    double TargetFrameRate() const { return m_decimator.TargetFrameRate(); }
+    bool IsEnabled() const { return m_decimator.IsEnabled(); }
+
+    void Reset()
+    {
+        m_decimator.Reset();
+        m_admitted.clear();
+    }
+
+    bool Admit(int64_t sampleTime)
+    {
+        if (!m_decimator.IsEnabled())
+        {
+            return true;
+        }
+
+        if (!m_decimator.ShouldDeliver(sampleTime))
+        {
+            return false;
+        }
+
+        if (m_admitted.size() >= MaxAdmitted)
+        {
+            m_admitted.pop_front();
+        }
+
+        m_admitted.push_back(sampleTime);
+
+        return true;
+    }
+
+    bool Take(int64_t sampleTime)
+    {
+        if (!m_decimator.IsEnabled())
+        {
+            return true;
+        }
+
+        // captures sharing a handler interleave their samples, search instead of
+        // assuming the oldest admitted sample arrives first
+        for (auto it = m_admitted.begin(); it != m_admitted.end(); ++it)
+        {
+            if (*it == sampleTime)
+            {
+                m_admitted.erase(it);
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    SampleDecimator m_decimator;
+    std::deque<int64_t> m_admitted;
+};
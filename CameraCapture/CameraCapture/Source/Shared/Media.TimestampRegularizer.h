@@ -0,0 +1,216 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Recovers the clock of a fixed rate stream from jittery timestamps (100ns units).
+// A least squares line through the last samples' frame index and timestamp gives
+// the frame period and phase; a timestamp that lands within tolerance of a grid
+// point is moved onto it, so jitter and a slowly drifting period are corrected
+// instead of producing out of order or duplicate times. Missing frames advance the
+// index by whole periods. A single timestamp off the grid is taken as a glitch and
+// left out of the fit: ahead of the grid it keeps its measured time, behind it it
+// is moved to the next grid point so it does not go backwards. A second one in a
+// row, or a gap longer than maxSkippedFrames (a pause or a stall), is a
+// discontinuity and restarts the model at the measured time.
+//
+// Has no platform dependencies so recorded timestamp traces can be replayed
+// through it anywhere.
+class TimestampRegularizer
+{
+public:
+    struct Result
+    {
+        int64_t timestamp;      // the timestamp to use, never at or before the previous one
+        uint32_t skippedFrames; // frames missing between this sample and the previous one
+        bool isCorrected;       // timestamp differs from the one passed in
+        bool isDiscontinuity;   // the model was restarted at this sample
+    };
+
+    // tolerance is the largest correction as a fraction of the period
+    TimestampRegularizer(size_t windowSize = 32, double tolerance = 0.25, uint32_t maxSkippedFrames = 30)
+        : m_windowSize(windowSize > MinSamples ? windowSize : MinSamples)
+        , m_tolerance(tolerance > 0.0 && tolerance < 0.5 ? tolerance : 0.25)
+        , m_maxSkippedFrames(maxSkippedFrames)
+        , m_nextSlot(0)
+        , m_origin{ 0, 0 }
+        , m_lastIndex(-1)
+        , m_lastTimestamp(0)
+        , m_isLastOutlier(false)
+        , m_slope(0.0)
+        , m_intercept(0.0)
+    {
+        m_window.reserve(m_windowSize);
+    }
+
+    void Reset()
+    {
+        m_window.clear();
+        m_nextSlot = 0;
+        m_lastIndex = -1;
+        m_lastTimestamp = 0;
+        m_isLastOutlier = false;
+        m_slope = 0.0;
+        m_intercept = 0.0;
+    }
+
+    // estimated frame period, 0 until enough samples were seen
+    double Period() const
+    {
+        return m_window.size() >= MinSamples && m_slope > 0.0 ? m_slope : 0.0;
+    }
+
+    Result Process(int64_t timestamp)
+    {
+        Result result{ timestamp, 0, false, false };
+
+        auto index = m_lastIndex + 1;
+        auto isOutlier = false;
+
+        if (m_lastIndex < 0)
+        {
+            result.isDiscontinuity = true;
+        }
+        else if (m_window.size() < MinSamples || m_slope <= 0.0)
+        {
+            // no period yet, only keep the timestamps moving forward
+        }
+        else
+        {
+            auto period = m_slope;
+            auto offset = static_cast<double>(timestamp) - Predict(index);
+            auto frames = std::llround(offset / period);
+            auto error = std::fabs(offset - frames * period);
+
+            auto isGap = frames > static_cast<long long>(m_maxSkippedFrames);
+
+            if (frames >= 0 && !isGap && error <= m_tolerance * period)
+            {
+                index += frames;
+
+                result.timestamp = std::llround(Predict(index));
+                result.skippedFrames = static_cast<uint32_t>(frames);
+            }
+            else if (!isGap && !m_isLastOutlier)
+            {
+                if (frames > 0)
+                {
+                    index += frames;
+                }
+                else if (offset < 0.0)
+                {
+                    result.timestamp = std::llround(Predict(index));
+                }
+
+                isOutlier = true;
+            }
+            else
+            {
+                Reset();
+
+                index = 0;
+                result.isDiscontinuity = true;
+            }
+        }
+
+        if (!result.isDiscontinuity && result.timestamp <= m_lastTimestamp)
+        {
+            result.timestamp = m_lastTimestamp + 1;
+        }
+
+        result.isCorrected = result.timestamp != timestamp;
+
+        // the model is fitted to what was measured, not to the corrected times
+        if (!isOutlier)
+        {
+            AddSample(index, timestamp);
+        }
+
+        m_isLastOutlier = isOutlier;
+        m_lastIndex = index;
+        m_lastTimestamp = result.timestamp;
+
+        return result;
+    }
+
+private:
+    static constexpr size_t MinSamples = 8;
+
+    struct Sample
+    {
+        int64_t index;
+        int64_t timestamp;
+    };
+
+    double Predict(int64_t index) const
+    {
+        return m_intercept + m_slope * static_cast<double>(index - m_origin.index) + static_cast<double>(m_origin.timestamp);
+    }
+
+    void AddSample(int64_t index, int64_t timestamp)
+    {
+        if (m_window.size() < m_windowSize)
+        {
+            m_window.push_back({ index, timestamp });
+        }
+        else
+        {
+            m_window[m_nextSlot] = { index, timestamp };
+            m_nextSlot = (m_nextSlot + 1) % m_windowSize;
+        }
+
+        Fit();
+    }
+
+    // least squares on values relative to the oldest sample to keep the precision
+    void Fit()
+    {
+        m_origin = m_window[m_window.size() < m_windowSize ? 0 : m_nextSlot];
+
+        auto count = static_cast<double>(m_window.size());
+
+        double sumX = 0.0;
+        double sumY = 0.0;
+        for (auto const& sample : m_window)
+        {
+            sumX += static_cast<double>(sample.index - m_origin.index);
+            sumY += static_cast<double>(sample.timestamp - m_origin.timestamp);
+        }
+
+        auto meanX = sumX / count;
+        auto meanY = sumY / count;
+
+        double sumXX = 0.0;
+        double sumXY = 0.0;
+        for (auto const& sample : m_window)
+        {
+            auto x = static_cast<double>(sample.index - m_origin.index) - meanX;
+            auto y = static_cast<double>(sample.timestamp - m_origin.timestamp) - meanY;
+
+            sumXX += x * x;
+            sumXY += x * y;
+        }
+
+        m_slope = sumXX > 0.0 ? sumXY / sumXX : 0.0;
+        m_intercept = meanY - m_slope * meanX;
+    }
+
+private:
+    size_t m_windowSize;
+    double m_tolerance;
+    uint32_t m_maxSkippedFrames;
+
+    std::vector<Sample> m_window;
+    size_t m_nextSlot;
+    Sample m_origin;
+    int64_t m_lastIndex;
+    int64_t m_lastTimestamp;
+    bool m_isLastOutlier;
+    double m_slope;
+    double m_intercept;
+};
@@ -3,6 +3,7 @@
 #include "Media.Transform.g.cpp"
 
 #include <Media.Payload.h>
+#include "Media.BatchMath.h"
 
 #include <winrt/windows.perception.spatial.preview.h>
 #include <winrt/windows.foundation.metadata.h>
@@ -52,13 +53,30 @@ static inline Windows::Foundation::Numerics::float4x4 GetProjection(MFPinholeCam
     return cameraAffine * defaultProjection;
 }
 
+// FNV-1a, only needs to tell one frame's calibration from the last one's
+static inline uint64_t HashBytes(void const* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    auto bytes = static_cast<uint8_t const*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
 Transform::Transform()
     : m_useNewApi(
         ApiInformation::IsApiContractPresent(L"Windows.Foundation.UniversalApiContract", 8)
         &&
         ApiInformation::IsMethodPresent(L"Windows.Perception.Spatial.Preview.SpatialGraphInteropPreview", L"CreateLocatorForNode"))
     , m_currentDynamicNodeId()
+    , m_calibrationCache{}
+    , m_calibration{}
 {
+    m_calibration.version = CAMERA_CALIBRATION_VERSION;
+    m_calibration.size = sizeof(CAMERA_CALIBRATION);
 }
 
 // Transform
@@ -71,6 +89,13 @@ bool Transform::ProcessWorldTransform(Media::Payload const& payload, Windows::Pe
 
     hresult hr = S_OK;
 
+    if (worldOrigin != m_historyOrigin)
+    {
+        m_poseHistory.Clear();
+
+        m_historyOrigin = worldOrigin;
+    }
+
     if (m_useNewApi)
     {
         hr = UpdateV2(payload, worldOrigin);
@@ -83,6 +108,62 @@ bool Transform::ProcessWorldTransform(Media::Payload const& payload, Windows::Pe
     return SUCCEEDED(hr);
 }
 
+// ICameraCalibrationPriv
+_Use_decl_annotations_
+hresult Transform::GetCameraCalibration(
+    CAMERA_CALIBRATION const** ppCalibration)
+{
+    NULL_CHK_HR(ppCalibration, E_INVALIDARG);
+
+    *ppCalibration = &m_calibration;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void Transform::PublishCalibration(
+    MFPinholeCameraIntrinsics const& intrinsics,
+    MFCameraExtrinsic_CalibratedTransform const& calibratedTransform,
+    int64_t sampleTime,
+    int64_t deviceTimestamp)
+{
+    auto const& model = intrinsics.IntrinsicModels[0];
+
+    // odd while written, the interlocked increments order the writes for readers on other cores
+    InterlockedIncrement(reinterpret_cast<volatile LONG*>(&m_calibration.changeCount));
+
+    m_calibration.width = model.Width;
+    m_calibration.height = model.Height;
+    m_calibration.focalLength = { model.CameraModel.FocalLength.x, model.CameraModel.FocalLength.y };
+    m_calibration.principalPoint = { model.CameraModel.PrincipalPoint.x, model.CameraModel.PrincipalPoint.y };
+    m_calibration.radialDistortion = { model.DistortionModel.Radial_k1, model.DistortionModel.Radial_k2, model.DistortionModel.Radial_k3 };
+    m_calibration.tangentialDistortion = { model.DistortionModel.Tangential_p1, model.DistortionModel.Tangential_p2 };
+    m_calibration.extrinsicPosition = { calibratedTransform.Position.x, calibratedTransform.Position.y, calibratedTransform.Position.z };
+    m_calibration.extrinsicOrientation = { calibratedTransform.Orientation.x, calibratedTransform.Orientation.y, calibratedTransform.Orientation.z, calibratedTransform.Orientation.w };
+    m_calibration.calibrationId = calibratedTransform.CalibrationId;
+    m_calibration.sampleTime = sampleTime;
+    m_calibration.deviceTimestamp = deviceTimestamp;
+
+    InterlockedIncrement(reinterpret_cast<volatile LONG*>(&m_calibration.changeCount));
+}
+
+_Use_decl_annotations_
+bool Transform::TryGetCameraToWorld(
+    int64_t timestamp,
+    float4x4& cameraToWorld)
+{
+    return m_poseHistory.TryGetCameraToWorld(timestamp, cameraToWorld);
+}
+
+_Use_decl_annotations_
+bool Transform::TryPredictCameraToWorld(
+    int64_t targetTime,
+    bool useAcceleration,
+    float4x4& cameraToWorld)
+{
+    return m_poseHistory.TryPredictCameraToWorld(targetTime, useAcceleration, cameraToWorld);
+}
+
 // ITransform
 _Use_decl_annotations_
 hresult Transform::Update(
@@ -117,12 +198,18 @@ hresult Transform::Update(
 
     // transform to world space
     Numerics::float4x4 invertedCameraView{};
-    if (Numerics::invert(cameraView, &invertedCameraView))
+    if (BatchMath::InvertMatrix(&cameraView.m11, &invertedCameraView.m11))
     {
         // overwrite the cameraView with new value
-        invertedCameraView *= cameraToWorld;
+        BatchMath::MultiplyMatrices(&invertedCameraView.m11, &cameraToWorld.m11, &invertedCameraView.m11, 1);
 
         streamSample->SetTransformAndProjection(invertedCameraView, cameraProjection);
+
+        UINT64 sampleTimeQpc = 0;
+        if (SUCCEEDED(streamSample->Sample()->GetUINT64(MFSampleExtension_DeviceTimestamp, &sampleTimeQpc)))
+        {
+            m_poseHistory.Add(static_cast<int64_t>(sampleTimeQpc), invertedCameraView);
+        }
     }
 
     return S_OK;
@@ -168,18 +255,35 @@ hresult Transform::UpdateV2(
         m_currentDynamicNodeId = dynamicNodeId;
     }
 
-    // compute extrinsic transform from sample data
-    const auto& translation
-        = make_float4x4_translation(calibratedTransform.Position.x, calibratedTransform.Position.y, calibratedTransform.Position.z);
-    const auto& rotation
-        = make_float4x4_from_quaternion(Numerics::quaternion{ calibratedTransform.Orientation.x, calibratedTransform.Orientation.y, calibratedTransform.Orientation.z, calibratedTransform.Orientation.w });
-    const auto& cameraToLocator
-        = rotation * translation;
-
     // get timestamp
     UINT64 sampleTimeQpc = 0;
     IFR(streamSample->Sample()->GetUINT64(MFSampleExtension_DeviceTimestamp, &sampleTimeQpc));
 
+    // compute extrinsic transform and projection from sample data when the calibration changed
+    auto calibrationKey = HashBytes(&calibratedTransform, sizeof(calibratedTransform), HashBytes(&cameraIntrinsics, sizeof(cameraIntrinsics)));
+    if (!m_calibrationCache.isValid
+        || calibrationKey != m_calibrationCache.key
+        || calibratedTransform.CalibrationId != m_calibrationCache.calibrationId)
+    {
+        const auto& translation
+            = make_float4x4_translation(calibratedTransform.Position.x, calibratedTransform.Position.y, calibratedTransform.Position.z);
+        const auto& rotation
+            = make_float4x4_from_quaternion(Numerics::quaternion{ calibratedTransform.Orientation.x, calibratedTransform.Orientation.y, calibratedTransform.Orientation.z, calibratedTransform.Orientation.w });
+
+        m_calibrationCache.cameraToLocator = rotation * translation;
+        m_calibrationCache.projection = GetProjection(cameraIntrinsics);
+        m_calibrationCache.calibrationId = calibratedTransform.CalibrationId;
+        m_calibrationCache.key = calibrationKey;
+        m_calibrationCache.isValid = true;
+
+        LONGLONG sampleTime = 0;
+        streamSample->Sample()->GetSampleTime(&sampleTime);
+
+        PublishCalibration(cameraIntrinsics, calibratedTransform, sampleTime, static_cast<int64_t>(sampleTimeQpc));
+    }
+
+    const auto& cameraToLocator = m_calibrationCache.cameraToLocator;
+
     TimeSpan deviceTimestamp{ sampleTimeQpc };
     auto frameTimestamp = PerceptionTimestampHelper::FromSystemRelativeTargetTime(deviceTimestamp);
 
@@ -193,12 +297,14 @@ hresult Transform::UpdateV2(
             = make_float4x4_from_quaternion(location.Orientation()) * make_float4x4_translation(location.Position());
 
         // transform matrix from locator to app world space
-        Windows::Foundation::Numerics::float4x4 cameraToWorld 
-            = cameraToLocator * dynamicNodeToCoordinateSystem;
+        Windows::Foundation::Numerics::float4x4 cameraToWorld{};
+        BatchMath::MultiplyMatrices(&cameraToLocator.m11, &dynamicNodeToCoordinateSystem.m11, &cameraToWorld.m11, 1);
 
         // generate the older projection matrix
         streamSample->SetTransformAndProjection(
-            cameraToWorld, GetProjection(cameraIntrinsics));
+            cameraToWorld, m_calibrationCache.projection);
+
+        m_poseHistory.Add(static_cast<int64_t>(sampleTimeQpc), cameraToWorld);
     }
 
     return S_OK;
@@ -208,4 +314,5 @@ void Transform::Reset()
 {
     m_locator = nullptr;
     m_frameOfReference = nullptr;
+    m_calibrationCache.isValid = false;
 }
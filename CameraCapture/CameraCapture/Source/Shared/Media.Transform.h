@@ -4,6 +4,14 @@
 #include <winrt/windows.perception.spatial.h>
 #include <mfapi.h>
 
+#include "Media.PoseHistory.h"
+
+
+struct __declspec(uuid("5b7e4d52-3c1a-4f0e-9a6b-2d8c71e0f4a3")) ICameraCalibrationPriv : ::IUnknown
+{
+    // the block lives as long as the object, it is updated in place
+    virtual winrt::hresult __stdcall GetCameraCalibration(_Outptr_ CAMERA_CALIBRATION const** ppCalibration) = 0;
+};
 
 //struct __declspec(uuid("27ee71f8-e7d3-435c-b394-42058efa6591")) ITransformPriv : ::IUnknown
 //{
@@ -14,7 +22,7 @@
 //
 namespace winrt::CameraCapture::Media::implementation
 {
-    struct Transform : TransformT<Transform>
+    struct Transform : TransformT<Transform, ICameraCalibrationPriv>
     {
         Transform();
         ~Transform() { Reset(); }
@@ -23,10 +31,26 @@ namespace winrt::CameraCapture::Media::implementation
         bool ProcessWorldTransform(
             Media::Payload const& payload, 
             Windows::Perception::Spatial::SpatialCoordinateSystem const& worldOrigin);
+        bool TryGetCameraToWorld(
+            int64_t timestamp,
+            Windows::Foundation::Numerics::float4x4& cameraToWorld);
+        bool TryPredictCameraToWorld(
+            int64_t targetTime,
+            bool useAcceleration,
+            Windows::Foundation::Numerics::float4x4& cameraToWorld);
+
+        // ICameraCalibrationPriv
+        virtual hresult __stdcall GetCameraCalibration(_Outptr_ CAMERA_CALIBRATION const** ppCalibration) override;
 
     private:
         void Reset();
 
+        void PublishCalibration(
+            _In_ MFPinholeCameraIntrinsics const& intrinsics,
+            _In_ MFCameraExtrinsic_CalibratedTransform const& calibratedTransform,
+            _In_ int64_t sampleTime,
+            _In_ int64_t deviceTimestamp);
+
         hresult Update(
             _In_ Media::Payload const& payload,
             _In_ Windows::Perception::Spatial::SpatialCoordinateSystem const& appCoordinateSystem);
@@ -35,11 +59,28 @@ namespace winrt::CameraCapture::Media::implementation
             _In_ Media::Payload const& payload,
             _In_ Windows::Perception::Spatial::SpatialCoordinateSystem const& appCoordinateSystem);
 
+    private:
+        // matrices derived from the calibration blobs, which rarely change in a session
+        struct CalibrationCache
+        {
+            bool isValid;
+            uint64_t key;
+            guid calibrationId;
+            Windows::Foundation::Numerics::float4x4 projection;
+            Windows::Foundation::Numerics::float4x4 cameraToLocator;
+        };
+
     private:
         boolean m_useNewApi;
         guid m_currentDynamicNodeId;
         Windows::Perception::Spatial::SpatialLocator m_locator{ nullptr };
         Windows::Perception::Spatial::SpatialLocatorAttachedFrameOfReference m_frameOfReference{ nullptr };
+        CalibrationCache m_calibrationCache;
+        CAMERA_CALIBRATION m_calibration;
+
+        // poses are in the space of the world origin they were located in
+        PoseHistory m_poseHistory;
+        Windows::Perception::Spatial::SpatialCoordinateSystem m_historyOrigin{ nullptr };
     };
 }
 
@@ -0,0 +1,78 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock free handoff between one producer and one consumer. The producer fills
+// Back() and publishes it, the consumer swaps in the newest published slot with
+// Consume() and reads Front() until the next swap. The slot held by each side is
+// never touched by the other, a published slot that was not consumed in time is
+// recycled by the producer.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+    {
+        Reset();
+    }
+
+    // producer side
+    T& Back()
+    {
+        return m_slots[m_back];
+    }
+
+    void Publish()
+    {
+        m_back = m_middle.exchange(static_cast<uint8_t>(m_back | DirtyFlag), std::memory_order_acq_rel) & IndexMask;
+    }
+
+    // consumer side, returns false if nothing was published since the last call
+    bool Consume()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & DirtyFlag) == 0)
+        {
+            return false;
+        }
+
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & IndexMask;
+
+        return true;
+    }
+
+    T& Front()
+    {
+        return m_slots[m_front];
+    }
+
+    // only while neither side is running
+    template <typename Func>
+    void ForEach(Func&& func)
+    {
+        for (auto&& slot : m_slots)
+        {
+            func(slot);
+        }
+    }
+
+    void Reset()
+    {
+        m_back = 0;
+        m_front = 1;
+        m_middle.store(2, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint8_t IndexMask = 0x3;
+    static constexpr uint8_t DirtyFlag = 0x4;
+
+    std::array<T, 3> m_slots;
+    uint8_t m_back;
+    uint8_t m_front;
+    std::atomic<uint8_t> m_middle;
+};
@@ -0,0 +1,190 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#include "pch.h"
+#include "Media.WorkQueueExecutor.h"
+
+#include <mferror.h>
+
+using namespace winrt;
+
+struct WorkItem : implements<WorkItem, IMFAsyncCallback>
+{
+    WorkItem(DWORD workQueueId, std::shared_ptr<std::atomic<bool>> const& isDiscarding, std::function<void()>&& work, bool mustRun)
+        : m_workQueueId(workQueueId)
+        , m_isDiscarding(isDiscarding)
+        , m_work(std::move(work))
+        , m_mustRun(mustRun)
+    {
+    }
+
+    // released by MF without being invoked, when its queue went away
+    ~WorkItem()
+    {
+        if (m_mustRun)
+        {
+            Run();
+        }
+    }
+
+    // never queued, the caller handles the work itself
+    void Cancel()
+    {
+        m_work = nullptr;
+    }
+
+    // IMFAsyncCallback
+    STDOVERRIDEMETHODIMP GetParameters(
+        __RPC__out DWORD *pdwFlags,
+        __RPC__out DWORD *pdwQueue)
+    {
+        *pdwFlags = 0;
+        *pdwQueue = m_workQueueId;
+
+        return S_OK;
+    }
+
+    STDOVERRIDEMETHODIMP Invoke(
+        __RPC__in_opt IMFAsyncResult *pAsyncResult)
+    {
+        UNREFERENCED_PARAMETER(pAsyncResult);
+
+        // the executor was shut down after the item was queued
+        if (m_isDiscarding->load() && !m_mustRun)
+        {
+            return S_OK;
+        }
+
+        Run();
+
+        return S_OK;
+    }
+
+private:
+    // runs the work at most once
+    void Run()
+    {
+        auto work = std::move(m_work);
+        m_work = nullptr;
+
+        if (!work)
+        {
+            return;
+        }
+
+        // nothing may escape into the MF callback
+        try
+        {
+            work();
+        }
+        catch (hresult_error const& e)
+        {
+            Log(L"WorkItem failed: %s\n", e.message().c_str());
+        }
+        catch (std::exception const& e)
+        {
+            Log(L"WorkItem failed: %hs\n", e.what());
+        }
+        catch (...)
+        {
+            Log(L"WorkItem failed: unknown exception\n");
+        }
+    }
+
+private:
+    DWORD m_workQueueId;
+    std::shared_ptr<std::atomic<bool>> m_isDiscarding;
+    std::function<void()> m_work;
+    bool m_mustRun;
+};
+
+std::shared_ptr<IExecutor> WorkQueueExecutor::CreateSerial()
+{
+    IFT(MFStartup(MF_VERSION));
+
+    DWORD workQueueId = MFASYNC_CALLBACK_QUEUE_UNDEFINED;
+    HRESULT hr = MFAllocateSerialWorkQueue(MFASYNC_CALLBACK_QUEUE_MULTITHREADED, &workQueueId);
+    if (FAILED(hr))
+    {
+        MFShutdown();
+
+        throw_hresult(hr);
+    }
+
+    return std::make_shared<WorkQueueExecutor>(workQueueId, true);
+}
+
+std::shared_ptr<IExecutor> WorkQueueExecutor::CreateMultithreaded()
+{
+    IFT(MFStartup(MF_VERSION));
+
+    return std::make_shared<WorkQueueExecutor>(MFASYNC_CALLBACK_QUEUE_MULTITHREADED, false);
+}
+
+WorkQueueExecutor::WorkQueueExecutor(DWORD workQueueId, bool ownsWorkQueue)
+    : m_workQueueId(workQueueId)
+    , m_ownsWorkQueue(ownsWorkQueue)
+    , m_isShutdown(false)
+    , m_isDiscarding(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+WorkQueueExecutor::~WorkQueueExecutor()
+{
+    Shutdown();
+}
+
+bool WorkQueueExecutor::Post(std::function<void()> work)
+{
+    return QueueWorkItem(std::move(work), false);
+}
+
+bool WorkQueueExecutor::PostMustRun(std::function<void()> work)
+{
+    return QueueWorkItem(std::move(work), true);
+}
+
+bool WorkQueueExecutor::QueueWorkItem(std::function<void()>&& work, bool mustRun)
+{
+    auto guard = m_cs.Guard();
+
+    if (m_isShutdown)
+    {
+        return false;
+    }
+
+    auto workItem = make_self<WorkItem>(m_workQueueId, m_isDiscarding, std::move(work), mustRun);
+
+    if (FAILED(MFPutWorkItem2(m_workQueueId, 0, workItem.get(), nullptr)))
+    {
+        // the caller runs it when Post fails
+        workItem->Cancel();
+
+        return false;
+    }
+
+    return true;
+}
+
+void WorkQueueExecutor::Shutdown()
+{
+    auto guard = m_cs.Guard();
+
+    if (m_isShutdown)
+    {
+        return;
+    }
+    m_isShutdown = true;
+
+    // items still queued are skipped unless they must run, one already running finishes
+    m_isDiscarding->store(true);
+
+    if (m_ownsWorkQueue)
+    {
+        MFUnlockWorkQueue(m_workQueueId);
+    }
+    m_workQueueId = MFASYNC_CALLBACK_QUEUE_UNDEFINED;
+
+    // balances the MFStartup in Create
+    MFShutdown();
+}
@@ -0,0 +1,38 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include "Media.Executor.h"
+
+#include <mfapi.h>
+
+// IExecutor backed by a Media Foundation work queue. Work items already handed
+// to MF check a flag shared with the executor, Shutdown sets it so they are
+// discarded instead of run; items posted with PostMustRun run regardless, or
+// when MF releases them without running them.
+struct WorkQueueExecutor : public IExecutor
+{
+    // private serial queue, work items run one at a time in order
+    static std::shared_ptr<IExecutor> CreateSerial();
+
+    // shared MF multithreaded queue
+    static std::shared_ptr<IExecutor> CreateMultithreaded();
+
+    WorkQueueExecutor(DWORD workQueueId, bool ownsWorkQueue);
+    ~WorkQueueExecutor();
+
+    // IExecutor
+    bool Post(std::function<void()> work) override;
+    bool PostMustRun(std::function<void()> work) override;
+    void Shutdown() override;
+
+private:
+    bool QueueWorkItem(std::function<void()>&& work, bool mustRun);
+
+    CriticalSection m_cs;
+    DWORD m_workQueueId;
+    bool m_ownsWorkQueue;
+    bool m_isShutdown;
+    std::shared_ptr<std::atomic<bool>> m_isDiscarding;
+};
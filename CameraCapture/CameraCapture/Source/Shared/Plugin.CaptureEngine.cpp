@@ -9,6 +9,9 @@
 #include "Media.Payload.h"
 #include "Media.Capture.MrcAudioEffect.h"
 #include "Media.Capture.MrcVideoEffect.h"
+#include "Media.WorkQueueExecutor.h"
+#include "Media.DeviceCatalog.h"
+#include "Media.Prewarm.h"
 
 #include <mferror.h>
 #include <mfmediacapture.h>
@@ -24,6 +27,31 @@ using namespace Windows::Media::Effects;
 using namespace Windows::Media::Core;
 using namespace Windows::Media::Capture;
 using namespace Windows::Media::MediaProperties;
+using namespace Windows::System::Threading;
+
+// microseconds since lapStart, which is moved to now for the next phase
+static uint32_t LapMicroseconds(std::chrono::steady_clock::time_point& lapStart)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - lapStart).count();
+
+    lapStart = now;
+
+    return static_cast<uint32_t>(elapsed);
+}
+
+// a cancelled coroutine unwinds at its next co_await, its event is set once it has
+static bool CancelIfStarted(IAsyncAction const& operation)
+{
+    if (operation == nullptr || operation.Status() != AsyncStatus::Started)
+    {
+        return false;
+    }
+
+    operation.Cancel();
+
+    return true;
+}
 
 _Use_decl_annotations_
 CameraCapture::Plugin::Module CaptureEngine::Create(
@@ -43,6 +71,7 @@ CameraCapture::Plugin::Module CaptureEngine::Create(
 
 CaptureEngine::CaptureEngine()
     : m_isShutdown(false)
+    , m_executor(WorkQueueExecutor::CreateMultithreaded())
     , m_startPreviewEventHandle(CreateEvent(nullptr, true, true, nullptr))
     , m_stopPreviewEventHandle(CreateEvent(nullptr, true, true, nullptr))
     , m_takePhotoEventHandle(CreateEvent(nullptr, true, true, nullptr))
@@ -59,13 +88,36 @@ CaptureEngine::CaptureEngine()
     , m_mrcAudioEffect(nullptr)
     , m_mrcVideoEffect(nullptr)
     , m_mrcPreviewEffect(nullptr)
+    , m_keepWarm(false)
+    , m_idleTimeoutMs(30000)
+    , m_idleGeneration(0)
+    , m_idleTimer(nullptr)
+    , m_warmWidth(0)
+    , m_warmHeight(0)
+    , m_startupTimings{}
+    , m_isAwaitingFirstFrame(false)
+    , m_teardownTimings{}
     , m_mediaSink(nullptr)
     , m_payloadHandler(nullptr)
+    , m_videoDecimation(std::make_shared<SubscriberDecimation>(0, 0.0))
     , m_audioSample(nullptr)
     , m_sharedVideoTexture(nullptr)
-    , m_photoTexture(nullptr)
-    , m_photoTextureSRV(nullptr)
-    , m_photoSample(nullptr)
+    , m_isTripleBuffered(false)
+    , m_renderDeviceTimestamp(0)
+    , m_copyFence(nullptr)
+    , m_renderCopyFence(nullptr)
+    , m_copyFenceValue(0)
+    , m_isCopyFenceSupported(true)
+    , m_lastRenderFrameId(0)
+    , m_displayTextureDesc{}
+    , m_displayTexture(nullptr)
+    , m_displayTextureSRV(nullptr)
+    , m_latestVideoTexture(nullptr)
+    , m_latestVideoState{}
+    , m_grabTexture(nullptr)
+    , m_photoBufferCount(0)
+    , m_nextPhotoBuffer(0)
+    , m_lastPhotoState{}
 {
 }
 
@@ -79,8 +131,25 @@ void CaptureEngine::Shutdown()
     }
     m_isShutdown = true;
 
-    // see if any outstanding operations are running
-    if (m_startPreviewOp != nullptr && m_startPreviewOp.Status() == AsyncStatus::Started)
+    auto teardownBegin = std::chrono::steady_clock::now();
+    auto lapStart = teardownBegin;
+
+    {
+        auto guard = m_cs.Guard();
+
+        CancelIdleTimer();
+
+        ZeroMemory(&m_teardownTimings, sizeof(TEARDOWN_TIMINGS));
+    }
+
+    // cancel outstanding operations, they unwind at their next co_await instead of running to completion
+    auto startPreviewOp = m_startPreviewOp;
+    auto takePhotoOp = m_takePhotoOp;
+
+    auto wasCancelled = CancelIfStarted(startPreviewOp);
+    wasCancelled = CancelIfStarted(takePhotoOp) || wasCancelled;
+
+    if (startPreviewOp != nullptr)
     {
         concurrency::create_task([this, strong]()
             {
@@ -88,7 +157,7 @@ void CaptureEngine::Shutdown()
             }).get();
     }
 
-    if (m_takePhotoOp != nullptr && m_takePhotoOp.Status() == AsyncStatus::Started)
+    if (takePhotoOp != nullptr)
     {
         concurrency::create_task([this, strong]()
             {
@@ -96,6 +165,8 @@ void CaptureEngine::Shutdown()
             }).get();
     }
 
+    auto cancelTime = LapMicroseconds(lapStart);
+
     if (m_mediaCapture != nullptr)
     {
         StopPreview();
@@ -109,6 +180,22 @@ void CaptureEngine::Shutdown()
             }).get();
     }
 
+    {
+        auto guard = m_cs.Guard();
+
+        // the StopPreview above measured the stream and release phases
+        m_teardownTimings.cancel = cancelTime;
+        m_teardownTimings.total = LapMicroseconds(teardownBegin);
+        m_teardownTimings.wasCancelled = wasCancelled;
+
+        Log(L"Shutdown: cancel %u, stop %u, release %u, total %u us%s\n",
+            m_teardownTimings.cancel,
+            m_teardownTimings.stopStream,
+            m_teardownTimings.release,
+            m_teardownTimings.total,
+            m_teardownTimings.wasCancelled ? L" (cancelled)" : L"");
+    }
+
     if (m_mediaSink != nullptr)
     {
         auto mfSink = m_mediaSink.try_as<IMFMediaSink>();
@@ -122,6 +209,8 @@ void CaptureEngine::Shutdown()
 
     ReleaseDeviceResources();
 
+    m_executor->Shutdown();
+
     Module::Shutdown();
 }
 
@@ -132,6 +221,8 @@ hresult CaptureEngine::StartPreview(uint32_t width, uint32_t height, bool enable
         IFR(E_ABORT);
     }
 
+    auto startupBegin = std::chrono::steady_clock::now();
+
     if (m_stopPreviewOp != nullptr && m_stopPreviewOp.Status() == AsyncStatus::Started)
     {
         concurrency::create_task([this]()
@@ -150,20 +241,33 @@ hresult CaptureEngine::StartPreview(uint32_t width, uint32_t height, bool enable
 
     ResetEvent(m_startPreviewEventHandle.get());
 
-    IFR(CreateDeviceResources());
-
-    if (m_sharedVideoTexture != nullptr)
     {
-        m_sharedVideoTexture->Reset();
+        auto guard = m_cs.Guard();
+
+        CancelIdleTimer();
 
-        m_sharedVideoTexture = nullptr;
+        ZeroMemory(&m_startupTimings, sizeof(STARTUP_TIMINGS));
+        m_startupBegin = startupBegin;
+        m_isAwaitingFirstFrame = false;
     }
 
+    IFR(CreateDeviceResources());
+
+    // the payload thread may still be copying into it, resources are freed with the last reference
+    m_sharedVideoTexture = nullptr;
+
+    SetLatestVideoFrame(nullptr, {});
+
+    ReleaseVideoFrames();
+
     m_startPreviewOp = StartPreviewCoroutine(width, height, enableAudio, enableMrc);
     m_startPreviewOp.Completed([this, strong = get_strong()](auto const& result, auto const& status)
     {
         m_startPreviewOp = nullptr;
 
+        // the coroutine only sets it when it runs to the end
+        SetEvent(m_startPreviewEventHandle.get());
+
         if (status == AsyncStatus::Error)
         {
             Failed(result.ErrorCode());
@@ -193,7 +297,16 @@ hresult CaptureEngine::StopPreview()
         IFR(E_ABORT);
     }
 
-    if (m_startPreviewOp != nullptr && m_startPreviewOp.Status() == AsyncStatus::Started)
+    auto teardownBegin = std::chrono::steady_clock::now();
+
+    // a start or photo that is still running is cancelled rather than waited out
+    auto startPreviewOp = m_startPreviewOp;
+    auto takePhotoOp = m_takePhotoOp;
+
+    auto wasCancelled = CancelIfStarted(startPreviewOp);
+    wasCancelled = CancelIfStarted(takePhotoOp) || wasCancelled;
+
+    if (startPreviewOp != nullptr)
     {
         concurrency::create_task([this]()
             {
@@ -201,7 +314,7 @@ hresult CaptureEngine::StopPreview()
             }).get();
     }
 
-    if (m_takePhotoOp != nullptr && m_takePhotoOp.Status() == AsyncStatus::Started)
+    if (takePhotoOp != nullptr)
     {
         concurrency::create_task([this]()
             {
@@ -211,11 +324,22 @@ hresult CaptureEngine::StopPreview()
 
     ResetEvent(m_stopPreviewEventHandle.get());
 
+    {
+        auto guard = m_cs.Guard();
+
+        ZeroMemory(&m_teardownTimings, sizeof(TEARDOWN_TIMINGS));
+        m_teardownTimings.cancel = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - teardownBegin).count());
+        m_teardownTimings.wasCancelled = wasCancelled;
+        m_teardownBegin = teardownBegin;
+    }
+
     m_stopPreviewOp = StopPreviewCoroutine();
     m_stopPreviewOp.Completed([this, strong = get_strong()](auto const& result, auto const& status)
     {
         m_stopPreviewOp = nullptr;
 
+        SetEvent(m_stopPreviewEventHandle.get());
+
         if (status == AsyncStatus::Error)
         {
             Failed(result.ErrorCode());
@@ -240,17 +364,19 @@ hresult CaptureEngine::StopPreview()
 
 hresult CaptureEngine::TakePhoto(uint32_t width, uint32_t height, bool enableMrc)
 {
-    if (m_takePhotoOp)
+    return TakePhotoBurst(width, height, 1, enableMrc);
+}
+
+hresult CaptureEngine::TakePhotoBurst(uint32_t width, uint32_t height, uint32_t count, bool enableMrc)
+{
+    if (count == 0 || count > MaxBurstCount)
     {
-        IFR(E_ABORT);
+        IFR(E_INVALIDARG);
     }
 
-    if (m_stopPreviewOp != nullptr && m_stopPreviewOp.Status() == AsyncStatus::Started)
+    if (m_takePhotoOp)
     {
-        concurrency::create_task([this]()
-            {
-                WaitForSingleObject(m_stopPreviewEventHandle.get(), INFINITE);
-            }).get();
+        IFR(E_ABORT);
     }
 
     if (m_stopPreviewOp != nullptr && m_stopPreviewOp.Status() == AsyncStatus::Started)
@@ -263,13 +389,21 @@ hresult CaptureEngine::TakePhoto(uint32_t width, uint32_t height, bool enableMrc
 
     ResetEvent(m_takePhotoEventHandle.get());
 
+    {
+        auto guard = m_cs.Guard();
+
+        CancelIdleTimer();
+    }
+
     IFR(CreateDeviceResources());
 
-    m_takePhotoOp = TakePhotoCoroutine(width, height, enableMrc);
+    m_takePhotoOp = TakePhotoCoroutine(width, height, count, enableMrc);
     m_takePhotoOp.Completed([this, strong = get_strong()](auto const& result, auto const& status)
     {
         m_takePhotoOp = nullptr;
 
+        SetEvent(m_takePhotoEventHandle.get());
+
         if (status == AsyncStatus::Error)
         {
             Failed(result.ErrorCode());
@@ -281,14 +415,8 @@ hresult CaptureEngine::TakePhoto(uint32_t width, uint32_t height, bool enableMrc
 
             state.type = CallbackType::Capture;
 
-            ZeroMemory(&state.value.captureState, sizeof(CAPTURE_STATE));
-
-            state.value.captureState.stateType = CaptureStateType::PhotoFrame;
-
-            // Set state values
-            state.value.captureState.width = m_photoTextureDesc.Width;
-            state.value.captureState.height = m_photoTextureDesc.Height;
-            state.value.captureState.texturePtr = m_photoTextureSRV.get();
+            // the earlier shots of a burst were raised as they were taken
+            state.value.captureState = m_lastPhotoState;
 
             Callback(state);
         }
@@ -308,8 +436,18 @@ void CaptureEngine::PayloadHandler(CameraCapture::Media::PayloadHandler const& v
 {
     auto strong = get_strong();
 
+    if (m_payloadHandler != nullptr)
+    {
+        get_self<Media::implementation::PayloadHandler>(m_payloadHandler)->RemoveDecimation(m_videoDecimation);
+    }
+
     m_payloadHandler = value;
 
+    if (m_payloadHandler != nullptr)
+    {
+        get_self<Media::implementation::PayloadHandler>(m_payloadHandler)->AddDecimation(m_videoDecimation);
+    }
+
     if (m_mediaSink != nullptr)
     {
         m_mediaSink.PayloadHandler(m_payloadHandler);
@@ -317,18 +455,6 @@ void CaptureEngine::PayloadHandler(CameraCapture::Media::PayloadHandler const& v
 
     m_payloadEventRevoker = m_payloadHandler.OnStreamPayload(winrt::auto_revoke, [this, strong](auto const sender, Media::Payload const& payload)
         {
-            auto guard = m_cs.Guard();
-
-            if (m_isShutdown)
-            {
-                return;
-            }
-
-            if (sender != m_payloadHandler)
-            {
-                return;
-            }
-
             if (payload == nullptr)
             {
                 return;
@@ -352,9 +478,83 @@ void CaptureEngine::PayloadHandler(CameraCapture::Media::PayloadHandler const& v
                 return;
             }
 
+            // only snapshot what this frame needs under the lock, the copy, transform and
+            // callback run without it so StartPreview/StopPreview are not held up by a frame
+            Media::PayloadHandler payloadHandler = nullptr;
+            std::shared_ptr<ID3D11DeviceResource> resources = nullptr;
+            com_ptr<IMFDXGIDeviceManager> dxgiDeviceManager = nullptr;
+            com_ptr<IMFSample> audioSample = nullptr;
+            com_ptr<SharedTexture> videoTexture = nullptr;
+            boolean isTripleBuffered = false;
+
+            {
+                auto guard = m_cs.Guard();
+
+                if (m_isShutdown)
+                {
+                    return;
+                }
+
+                if (sender != m_payloadHandler)
+                {
+                    return;
+                }
+
+                payloadHandler = m_payloadHandler;
+
+                if (MFMediaType_Audio == majorType)
+                {
+                    audioSample = m_audioSample;
+                }
+                else if (MFMediaType_Video == majorType)
+                {
+                    // created by StartPreview, released devices drop the frame rather than
+                    // recreating them on the payload thread
+                    NULL_CHK_R(m_dxgiDeviceManager);
+
+                    resources = m_d3d11DeviceResources.lock();
+                    NULL_CHK_R(resources);
+
+                    dxgiDeviceManager = m_dxgiDeviceManager;
+                    videoTexture = m_sharedVideoTexture;
+                    isTripleBuffered = m_isTripleBuffered;
+
+                    if (m_isAwaitingFirstFrame)
+                    {
+                        m_isAwaitingFirstFrame = false;
+
+                        auto now = std::chrono::steady_clock::now();
+                        m_startupTimings.firstFrame = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - m_streamStarted).count());
+                        m_startupTimings.total = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - m_startupBegin).count());
+
+                        Log(L"Start up: discovery %u, format %u, initialize %u, stream properties %u, effects %u, start %u, first frame %u, total %u us%s\n",
+                            m_startupTimings.deviceDiscovery,
+                            m_startupTimings.formatSelection,
+                            m_startupTimings.initialize,
+                            m_startupTimings.streamProperties,
+                            m_startupTimings.effects,
+                            m_startupTimings.startStream,
+                            m_startupTimings.firstFrame,
+                            m_startupTimings.total,
+                            m_startupTimings.isWarmStart ? L" (warm)" : L"");
+                    }
+                }
+            }
+
+            // the frame may only have been queued for another subscriber of the handler
+            if (MFMediaType_Video == majorType)
+            {
+                LONGLONG sampleTime = 0;
+                if (SUCCEEDED(streamSample->Sample()->GetSampleTime(&sampleTime))
+                    && !get_self<Media::implementation::PayloadHandler>(payloadHandler)->IsAdmitted(m_videoDecimation, sampleTime))
+                {
+                    return;
+                }
+            }
+
             if (MFMediaType_Audio == majorType)
             {
-                if (m_audioSample == nullptr)
+                if (audioSample == nullptr)
                 {
                     DWORD bufferSize = 0;
                     IFV(streamSample->Sample()->GetTotalLength(&bufferSize));
@@ -367,10 +567,17 @@ void CaptureEngine::PayloadHandler(CameraCapture::Media::PayloadHandler const& v
 
                     IFV(dstSample->AddBuffer(dstBuffer.get()));
 
-                    m_audioSample.attach(dstSample.detach());
+                    audioSample.attach(dstSample.detach());
+
+                    auto guard = m_cs.Guard();
+
+                    if (!m_isShutdown && m_audioSample == nullptr)
+                    {
+                        m_audioSample = audioSample;
+                    }
                 }
 
-                IFV(CopySample(MFMediaType_Audio, streamSample->Sample(), m_audioSample));
+                IFV(CopySample(MFMediaType_Audio, streamSample->Sample(), audioSample));
 
                 CALLBACK_STATE state{};
                 ZeroMemory(&state, sizeof(CALLBACK_STATE));
@@ -385,52 +592,92 @@ void CaptureEngine::PayloadHandler(CameraCapture::Media::PayloadHandler const& v
                 //state.value.captureState.texturePtr = nullptr;
                 Callback(state);
             }
+            else if (MFMediaType_Video == majorType && isTripleBuffered)
+            {
+                // the render thread raises the callback when it presents the frame
+                IFV(PublishVideoFrame(payloadHandler, resources, dxgiDeviceManager, payload, streamSample->Sample()));
+            }
             else if (MFMediaType_Video == majorType)
             {
                 boolean bufferChanged = false;
 
                 auto videoProps = payload.EncodingProperties().as<IVideoEncodingProperties>();
 
-                if (m_sharedVideoTexture == nullptr
+                if (videoTexture == nullptr
                     ||
-                    m_sharedVideoTexture->frameTexture == nullptr
+                    videoTexture->frameTexture == nullptr
                     ||
-                    m_sharedVideoTexture->frameTextureDesc.Width != videoProps.Width()
+                    videoTexture->frameTextureDesc.Width != videoProps.Width()
                     ||
-                    m_sharedVideoTexture->frameTextureDesc.Height != videoProps.Height())
+                    videoTexture->frameTextureDesc.Height != videoProps.Height())
                 {
-                    auto resources = m_d3d11DeviceResources.lock();
-                    NULL_CHK_R(resources);
+                    auto previousTexture = videoTexture;
+
+                    IFV(SharedTexture::Create(resources->GetDevice(), dxgiDeviceManager, videoProps.Width(), videoProps.Height(), videoTexture));
 
-                    // make sure we have created our own d3d device
-                    IFV(CreateDeviceResources());
+                    auto guard = m_cs.Guard();
 
-                    IFV(SharedTexture::Create(resources->GetDevice(), m_dxgiDeviceManager, videoProps.Width(), videoProps.Height(), m_sharedVideoTexture));
+                    // a restart or shutdown released the texture in the meantime
+                    if (m_isShutdown || m_sharedVideoTexture != previousTexture)
+                    {
+                        return;
+                    }
+
+                    m_sharedVideoTexture = videoTexture;
 
                     bufferChanged = true;
                 }
 
-                // copy the data
-                IFV(CopySample(MFMediaType_Video, streamSample->Sample(), m_sharedVideoTexture->mediaSample));
-
-                // did the texture description change, if so, raise callback
                 CALLBACK_STATE state{};
                 ZeroMemory(&state, sizeof(CALLBACK_STATE));
 
-                state.type = CallbackType::Capture;
+                // GrabFrame copies the latest frame under it, the frame is written and made the
+                // latest as one step
+                {
+                    auto grabGuard = m_grabCs.Guard();
 
-                ZeroMemory(&state.value.captureState, sizeof(CAPTURE_STATE));
+                    // copy the data
+                    IFV(CopySample(MFMediaType_Video, streamSample->Sample(), videoTexture->mediaSample));
 
-                state.value.captureState.stateType = CaptureStateType::PreviewVideoFrame;
-                state.value.captureState.width = m_sharedVideoTexture->frameTextureDesc.Width;
-                state.value.captureState.height = m_sharedVideoTexture->frameTextureDesc.Height;
-                state.value.captureState.texturePtr = m_sharedVideoTexture->frameTextureSRV.get();
-                if (m_payloadHandler.ProceesTranform(payload))
-                {
-                    state.value.captureState.worldMatrix = payload.CameraToWorld();
-                    state.value.captureState.projectionMatrix = payload.CameraProjection();
+                    auto deviceTimestamp = FrameLatency::DeviceTimestamp(streamSample->Sample().get());
 
-                    bufferChanged = true;
+                    FrameLatency::Instance()->Record(LatencyStage::CopyDone, deviceTimestamp);
+
+                    // Unity samples the shared texture from the next render event
+                    m_renderDeviceTimestamp = deviceTimestamp;
+
+                    // did the texture description change, if so, raise callback
+                    state.type = CallbackType::Capture;
+
+                    ZeroMemory(&state.value.captureState, sizeof(CAPTURE_STATE));
+
+                    state.value.captureState.stateType = CaptureStateType::PreviewVideoFrame;
+                    state.value.captureState.width = videoTexture->frameTextureDesc.Width;
+                    state.value.captureState.height = videoTexture->frameTextureDesc.Height;
+                    state.value.captureState.texturePtr = videoTexture->frameTextureSRV.get();
+
+                    LONGLONG sampleTime = 0;
+                    if (SUCCEEDED(streamSample->Sample()->GetSampleTime(&sampleTime)))
+                    {
+                        state.value.captureState.timestamp = sampleTime;
+                    }
+                    state.value.captureState.deviceTimestamp = deviceTimestamp;
+
+                    UINT32 frameFlags = 0;
+                    if (SUCCEEDED(streamSample->Sample()->GetUINT32(MF_PAYLOAD_FRAME_FLAGS, &frameFlags)))
+                    {
+                        state.value.captureState.flags = frameFlags;
+                    }
+
+                    // the pose is located on the pose worker, the frame is not held back for it
+                    payloadHandler.QueueTransform(payload);
+
+                    if (EstimateFramePose(payloadHandler, state.value.captureState))
+                    {
+                        bufferChanged = true;
+                    }
+
+                    SetLatestVideoFrame(videoTexture, state.value.captureState);
                 }
 
                 if (bufferChanged)
@@ -441,6 +688,108 @@ void CaptureEngine::PayloadHandler(CameraCapture::Media::PayloadHandler const& v
         });
 }
 
+hresult CaptureEngine::TripleBuffering(bool enable)
+{
+    m_isTripleBuffered = enable;
+
+    return S_OK;
+}
+
+hresult CaptureEngine::FrameDecimation(uint32_t frameInterval, double targetFrameRate)
+{
+    auto guard = m_cs.Guard();
+
+    // once added, the payload handler runs the decimation under its own lock
+    if (m_payloadHandler != nullptr)
+    {
+        get_self<Media::implementation::PayloadHandler>(m_payloadHandler)->ConfigureDecimation(m_videoDecimation, frameInterval, targetFrameRate);
+    }
+    else
+    {
+        m_videoDecimation->Configure(frameInterval, targetFrameRate);
+    }
+
+    return S_OK;
+}
+
+hresult CaptureEngine::KeepWarm(bool enable, uint32_t idleTimeoutMs)
+{
+    auto guard = m_cs.Guard();
+
+    m_keepWarm = enable;
+    m_idleTimeoutMs = idleTimeoutMs;
+
+    // nothing is streaming, restart the countdown or release now
+    if (m_mediaCapture != nullptr && m_mediaSink == nullptr && m_startPreviewOp == nullptr && m_takePhotoOp == nullptr)
+    {
+        if (m_keepWarm)
+        {
+            StartIdleTimer();
+        }
+        else
+        {
+            CancelIdleTimer();
+
+            ReleaseIdleCaptureAsync(m_idleGeneration);
+        }
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CaptureEngine::OnRenderEvent(
+    uint16_t frameNumber)
+{
+    if (m_isTripleBuffered && !m_isShutdown)
+    {
+        CALLBACK_STATE state{};
+        ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+        state.type = CallbackType::Capture;
+
+        ZeroMemory(&state.value.captureState, sizeof(CAPTURE_STATE));
+
+        // published with the frame, the render thread never takes m_cs
+        Media::PayloadHandler payloadHandler = nullptr;
+
+        hresult hr = S_FALSE;
+
+        {
+            auto guard = m_renderCs.Guard();
+
+            // present at most once per Unity frame
+            if (frameNumber != m_lastRenderFrameId || m_displayTexture == nullptr)
+            {
+                hr = PresentVideoFrame(state.value.captureState, payloadHandler);
+            }
+
+            m_lastRenderFrameId = frameNumber;
+        }
+
+        if (hr == S_OK)
+        {
+            // the frame was published with an estimated pose, by now it has usually been located
+            EstimateFramePose(payloadHandler, state.value.captureState);
+
+            FrameLatency::Instance()->Record(LatencyStage::RenderEvent, state.value.captureState.deviceTimestamp);
+
+            Callback(state);
+        }
+    }
+    else
+    {
+        auto deviceTimestamp = m_renderDeviceTimestamp.exchange(0);
+        if (deviceTimestamp != 0)
+        {
+            FrameLatency::Instance()->Record(LatencyStage::RenderEvent, deviceTimestamp);
+        }
+    }
+
+    // deliver anything queued for this frame, including the callback above
+    Module::OnRenderEvent(frameNumber);
+}
+
 CameraCapture::Media::Capture::Sink CaptureEngine::MediaSink()
 {
     auto guard = m_cs.Guard();
@@ -448,6 +797,30 @@ CameraCapture::Media::Capture::Sink CaptureEngine::MediaSink()
     return m_mediaSink;
 }
 
+_Use_decl_annotations_
+hresult CaptureEngine::GetStartupTimings(STARTUP_TIMINGS* pTimings)
+{
+    NULL_CHK_HR(pTimings, E_INVALIDARG);
+
+    auto guard = m_cs.Guard();
+
+    *pTimings = m_startupTimings;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+hresult CaptureEngine::GetTeardownTimings(TEARDOWN_TIMINGS* pTimings)
+{
+    NULL_CHK_HR(pTimings, E_INVALIDARG);
+
+    auto guard = m_cs.Guard();
+
+    *pTimings = m_teardownTimings;
+
+    return S_OK;
+}
+
 // private
 hresult CaptureEngine::CreateDeviceResources()
 {
@@ -467,16 +840,20 @@ hresult CaptureEngine::CreateDeviceResources()
         IFR(dxgiDevice->GetAdapter(dxgiAdapter.put()));
     }
 
+    // use the device made by the prewarm if it is on the same adapter, waits if it is still running
     com_ptr<ID3D11Device> mediaDevice = nullptr;
-    IFR(CreateMediaDevice(dxgiAdapter.get(), mediaDevice.put()));
-
-    // create DXGIManager
-    uint32_t resetToken;
     com_ptr<IMFDXGIDeviceManager> dxgiDeviceManager = nullptr;
-    IFR(MFCreateDXGIDeviceManager(&resetToken, dxgiDeviceManager.put()));
+    uint32_t resetToken = 0;
+    if (!Prewarmer::Instance()->TakeMediaDevice(dxgiAdapter.get(), mediaDevice, dxgiDeviceManager, resetToken))
+    {
+        IFR(CreateMediaDevice(dxgiAdapter.get(), mediaDevice.put()));
+
+        // create DXGIManager
+        IFR(MFCreateDXGIDeviceManager(&resetToken, dxgiDeviceManager.put()));
 
-    // associate device with dxgiManager
-    IFR(dxgiDeviceManager->ResetDevice(mediaDevice.get(), resetToken));
+        // associate device with dxgiManager
+        IFR(dxgiDeviceManager->ResetDevice(mediaDevice.get(), resetToken));
+    }
 
     // success, store the values
     m_mediaDevice.attach(mediaDevice.detach());
@@ -493,23 +870,24 @@ void CaptureEngine::ReleaseDeviceResources()
         m_audioSample = nullptr;
     }
 
-    if (m_sharedVideoTexture != nullptr)
-    {
-        m_sharedVideoTexture->Reset();
+    // the payload thread may still be copying into it, resources are freed with the last reference
+    m_sharedVideoTexture = nullptr;
 
-        m_sharedVideoTexture = nullptr;
-    }
+    SetLatestVideoFrame(nullptr, {});
 
-    if (m_photoTexture != nullptr)
     {
-        m_photoTexture = nullptr;
-    }
+        auto guard = m_grabCs.Guard();
 
-    if (m_photoTextureSRV != nullptr)
-    {
-        m_photoTextureSRV = nullptr;
+        m_grabTexture = nullptr;
     }
 
+    ReleaseVideoFrames();
+
+    m_photoBuffers.clear();
+    m_photoBufferCount = 0;
+    m_nextPhotoBuffer = 0;
+    ZeroMemory(&m_lastPhotoState, sizeof(CAPTURE_STATE));
+
     if (m_dxgiDeviceManager != nullptr)
     {
         if (m_mediaDevice != nullptr)
@@ -528,42 +906,424 @@ void CaptureEngine::ReleaseDeviceResources()
     }
 }
 
-
-IAsyncAction CaptureEngine::StartPreviewCoroutine(
-    uint32_t width, uint32_t height,
-    boolean enableAudio, boolean enableMrc)
+_Use_decl_annotations_
+hresult CaptureEngine::PublishVideoFrame(
+    Media::PayloadHandler const& payloadHandler,
+    std::shared_ptr<ID3D11DeviceResource> const& resources,
+    com_ptr<IMFDXGIDeviceManager> const& dxgiDeviceManager,
+    Media::Payload const& payload,
+    com_ptr<IMFSample> const& sample)
 {
-    winrt::apartment_context calling_thread;
+    auto videoProps = payload.EncodingProperties().as<IVideoEncodingProperties>();
 
-    co_await resume_background();
+    com_ptr<SharedTexture> texture = nullptr;
+    CAPTURE_STATE state{};
 
-    auto guard = m_cs.Guard();
+    // GrabFrame copies the latest frame under it, a slot is not written again until the
+    // copy of it is queued
+    auto grabGuard = m_grabCs.Guard();
 
-    if (m_mediaCapture == nullptr)
-    {
-        co_await CreateMediaCaptureAsync(width, height, enableAudio);
-    }
-    else
+    // teardown takes it to stop the producer before it drops the slots, the render thread
+    // never does; SetLatestVideoFrame takes m_cs, which teardown holds while it waits
     {
-        co_await RemoveMrcEffectsAsync();
-    }
+        auto guard = m_publishCs.Guard();
 
-    // set video controller properties
-    auto videoController = m_mediaCapture.VideoDeviceController();
+        // the back slot is never read by the render thread
+        auto& slot = m_videoFrames.Back();
+        if (slot.texture == nullptr
+            ||
+            slot.texture->frameTexture == nullptr
+            ||
+            slot.texture->frameTextureDesc.Width != videoProps.Width()
+            ||
+            slot.texture->frameTextureDesc.Height != videoProps.Height())
+        {
+            IFR(SharedTexture::Create(resources->GetDevice(), dxgiDeviceManager, videoProps.Width(), videoProps.Height(), slot.texture));
+        }
 
-    try
-    {
-        videoController.DesiredOptimization(Windows::Media::Devices::MediaCaptureOptimization::LatencyThenQuality);
-    }
+        IFR(CopySample(MFMediaType_Video, sample, slot.texture->mediaSample));
+
+        IFR(SyncVideoFrame(resources->GetDevice(), slot));
+
+        ZeroMemory(&slot.state, sizeof(CAPTURE_STATE));
+
+        slot.state.stateType = CaptureStateType::PreviewVideoFrame;
+        slot.state.width = slot.texture->frameTextureDesc.Width;
+        slot.state.height = slot.texture->frameTextureDesc.Height;
+
+        LONGLONG sampleTime = 0;
+        if (SUCCEEDED(sample->GetSampleTime(&sampleTime)))
+        {
+            slot.state.timestamp = sampleTime;
+        }
+        slot.state.deviceTimestamp = FrameLatency::DeviceTimestamp(sample.get());
+
+        UINT32 frameFlags = 0;
+        if (SUCCEEDED(sample->GetUINT32(MF_PAYLOAD_FRAME_FLAGS, &frameFlags)))
+        {
+            slot.state.flags = frameFlags;
+        }
+
+        FrameLatency::Instance()->Record(LatencyStage::CopyDone, slot.state.deviceTimestamp);
+
+        payloadHandler.QueueTransform(payload);
+
+        EstimateFramePose(payloadHandler, slot.state);
+
+        slot.payloadHandler = payloadHandler;
+
+        texture = slot.texture;
+        state = slot.state;
+
+        m_videoFrames.Publish();
+    }
+
+    SetLatestVideoFrame(texture, state);
+
+    return S_OK;
+}
+
+// the media device only queued the copy into the slot, make the Unity device wait for it:
+// with a fence shared between the devices when both support it, otherwise by waiting for
+// the copy on the payload thread
+_Use_decl_annotations_
+hresult CaptureEngine::SyncVideoFrame(
+    com_ptr<ID3D11Device> const& renderDevice,
+    VideoFrameSlot& slot)
+{
+    slot.fence = nullptr;
+    slot.fenceValue = 0;
+
+    NULL_CHK_HR(renderDevice, E_INVALIDARG);
+
+    com_ptr<ID3D11Device> mediaDevice = nullptr;
+    slot.texture->mediaTexture->GetDevice(mediaDevice.put());
+
+    com_ptr<ID3D11DeviceContext> mediaContext = nullptr;
+    mediaDevice->GetImmediateContext(mediaContext.put());
+
+    if (m_copyFence == nullptr && m_isCopyFenceSupported)
+    {
+        m_isCopyFenceSupported = false;
+
+        auto mediaDevice5 = mediaDevice.try_as<ID3D11Device5>();
+        auto renderDevice5 = renderDevice.try_as<ID3D11Device5>();
+        if (mediaDevice5 != nullptr && renderDevice5 != nullptr)
+        {
+            com_ptr<ID3D11Fence> copyFence = nullptr;
+            com_ptr<ID3D11Fence> renderCopyFence = nullptr;
+            HANDLE fenceHandle = nullptr;
+            if (SUCCEEDED(mediaDevice5->CreateFence(0, D3D11_FENCE_FLAG_SHARED, __uuidof(ID3D11Fence), copyFence.put_void()))
+                && SUCCEEDED(copyFence->CreateSharedHandle(nullptr, GENERIC_ALL, nullptr, &fenceHandle)))
+            {
+                if (SUCCEEDED(renderDevice5->OpenSharedFence(fenceHandle, __uuidof(ID3D11Fence), renderCopyFence.put_void())))
+                {
+                    m_copyFence.attach(copyFence.detach());
+                    m_renderCopyFence.attach(renderCopyFence.detach());
+                    m_copyFenceValue = 0;
+                    m_isCopyFenceSupported = true;
+                }
+
+                CloseHandle(fenceHandle);
+            }
+        }
+    }
+
+    auto mediaContext4 = mediaContext.try_as<ID3D11DeviceContext4>();
+    if (m_copyFence != nullptr && mediaContext4 != nullptr)
+    {
+        IFR(mediaContext4->Signal(m_copyFence.get(), ++m_copyFenceValue));
+
+        // the signal has to reach the GPU before the render device can see it
+        mediaContext->Flush();
+
+        slot.fence = m_renderCopyFence;
+        slot.fenceValue = m_copyFenceValue;
+
+        return S_OK;
+    }
+
+    D3D11_QUERY_DESC queryDesc{ D3D11_QUERY_EVENT, 0 };
+
+    com_ptr<ID3D11Query> copyDone = nullptr;
+    IFR(mediaDevice->CreateQuery(&queryDesc, copyDone.put()));
+
+    mediaContext->End(copyDone.get());
+
+    BOOL isDone = FALSE;
+    HRESULT hr = S_FALSE;
+    while ((hr = mediaContext->GetData(copyDone.get(), &isDone, sizeof(BOOL), 0)) == S_FALSE)
+    {
+        SwitchToThread();
+    }
+    IFR(hr);
+
+    return S_OK;
+}
+
+// the located pose once the pose worker got to the frame, predicted from the frames
+// before it until then; false if there is no pose yet
+_Use_decl_annotations_
+bool CaptureEngine::EstimateFramePose(
+    Media::PayloadHandler const& payloadHandler,
+    CAPTURE_STATE& state)
+{
+    if (payloadHandler == nullptr || state.deviceTimestamp == 0)
+    {
+        return false;
+    }
+
+    Windows::Foundation::Numerics::float4x4 projection{};
+    if (!payloadHandler.TryGetCameraProjection(projection))
+    {
+        return false;
+    }
+
+    Windows::Foundation::Numerics::float4x4 cameraToWorld{};
+    if (!payloadHandler.TryPredictCameraToWorld(state.deviceTimestamp, false, cameraToWorld))
+    {
+        return false;
+    }
+
+    state.worldMatrix = cameraToWorld;
+    state.projectionMatrix = projection;
+
+    return true;
+}
+
+// render thread, returns S_FALSE if no new frame was published
+_Use_decl_annotations_
+hresult CaptureEngine::PresentVideoFrame(
+    CAPTURE_STATE& state,
+    Media::PayloadHandler& payloadHandler)
+{
+    if (!m_videoFrames.Consume())
+    {
+        return S_FALSE;
+    }
+
+    auto& slot = m_videoFrames.Front();
+    NULL_CHK_HR(slot.texture, S_FALSE);
+    NULL_CHK_HR(slot.texture->frameTexture, S_FALSE);
+
+    auto resources = m_d3d11DeviceResources.lock();
+    NULL_CHK_HR(resources, MF_E_UNEXPECTED);
+
+    auto d3dDevice = resources->GetDevice();
+    NULL_CHK_HR(d3dDevice, MF_E_UNEXPECTED);
+
+    // Unity keeps sampling the same texture, only recreated when the size changes
+    if (m_displayTexture == nullptr
+        ||
+        m_displayTextureDesc.Width != slot.texture->frameTextureDesc.Width
+        ||
+        m_displayTextureDesc.Height != slot.texture->frameTextureDesc.Height)
+    {
+        auto textureDesc = CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_B8G8R8A8_UNORM, slot.texture->frameTextureDesc.Width, slot.texture->frameTextureDesc.Height);
+        textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        textureDesc.MipLevels = 1;
+        textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+        com_ptr<ID3D11Texture2D> texture = nullptr;
+        IFR(d3dDevice->CreateTexture2D(&textureDesc, nullptr, texture.put()));
+
+        auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(texture.get(), D3D11_SRV_DIMENSION_TEXTURE2D);
+
+        com_ptr<ID3D11ShaderResourceView> textureSRV = nullptr;
+        IFR(d3dDevice->CreateShaderResourceView(texture.get(), &srvDesc, textureSRV.put()));
+
+        m_displayTextureDesc = textureDesc;
+        m_displayTexture.attach(texture.detach());
+        m_displayTextureSRV.attach(textureSRV.detach());
+    }
+
+    com_ptr<ID3D11DeviceContext> d3dContext = nullptr;
+    d3dDevice->GetImmediateContext(d3dContext.put());
+
+    // the media device wrote the slot, the GPU waits for that copy before reading it
+    if (slot.fence != nullptr)
+    {
+        auto d3dContext4 = d3dContext.try_as<ID3D11DeviceContext4>();
+        if (d3dContext4 != nullptr)
+        {
+            IFR(d3dContext4->Wait(slot.fence.get(), slot.fenceValue));
+        }
+    }
+
+    d3dContext->CopyResource(m_displayTexture.get(), slot.texture->frameTexture.get());
+
+    state = slot.state;
+    state.texturePtr = m_displayTextureSRV.get();
+
+    payloadHandler = slot.payloadHandler;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+hresult CaptureEngine::GrabFrame(
+    CAPTURE_STATE* pState)
+{
+    NULL_CHK_HR(pState, E_INVALIDARG);
+
+    ZeroMemory(pState, sizeof(CAPTURE_STATE));
+
+    auto resources = m_d3d11DeviceResources.lock();
+    NULL_CHK_HR(resources, MF_E_UNEXPECTED);
+
+    // the payload thread can not write or replace the latest frame until its copy is queued
+    auto grabGuard = m_grabCs.Guard();
+
+    com_ptr<SharedTexture> videoTexture = nullptr;
+    CAPTURE_STATE state{};
+    com_ptr<IMFDXGIDeviceManager> dxgiDeviceManager = nullptr;
+
+    {
+        auto guard = m_cs.Guard();
+
+        if (m_isShutdown)
+        {
+            IFR(MF_E_SHUTDOWN);
+        }
+
+        videoTexture = m_latestVideoTexture;
+        state = m_latestVideoState;
+        dxgiDeviceManager = m_dxgiDeviceManager;
+    }
+
+    // no preview running or no frame yet
+    NULL_CHK_HR(videoTexture, MF_E_INVALIDREQUEST);
+    NULL_CHK_HR(dxgiDeviceManager, MF_E_INVALIDREQUEST);
+
+    if (m_grabTexture == nullptr
+        ||
+        m_grabTexture->frameTextureDesc.Width != videoTexture->frameTextureDesc.Width
+        ||
+        m_grabTexture->frameTextureDesc.Height != videoTexture->frameTextureDesc.Height)
+    {
+        IFR(SharedTexture::Create(resources->GetDevice(), dxgiDeviceManager, videoTexture->frameTextureDesc.Width, videoTexture->frameTextureDesc.Height, m_grabTexture));
+    }
+
+    // gpu copy on the media device, it is queued behind the copy that wrote the frame
+    // and ahead of the next one
+    IFR(CopySample(MFMediaType_Video, videoTexture->mediaSample, m_grabTexture->mediaSample));
+
+    state.stateType = CaptureStateType::PhotoFrame;
+    state.width = m_grabTexture->frameTextureDesc.Width;
+    state.height = m_grabTexture->frameTextureDesc.Height;
+    state.texturePtr = m_grabTexture->frameTextureSRV.get();
+
+    *pState = state;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CaptureEngine::SetLatestVideoFrame(
+    com_ptr<SharedTexture> const& texture,
+    CAPTURE_STATE const& state)
+{
+    auto guard = m_cs.Guard();
+
+    // a frame that was in flight while the preview stopped
+    if (texture != nullptr && m_payloadHandler == nullptr)
+    {
+        return;
+    }
+
+    m_latestVideoTexture = texture;
+    m_latestVideoState = state;
+}
+
+void CaptureEngine::ReleaseVideoFrames()
+{
+    // waits for a frame the payload thread is publishing, then keeps it out
+    auto publishGuard = m_publishCs.Guard();
+    auto guard = m_renderCs.Guard();
+
+    // only drop the references, a texture handed out by GrabFrame or the last
+    // frame may still be in use and is released with its last owner
+    m_videoFrames.ForEach([](VideoFrameSlot& slot)
+    {
+        slot.texture = nullptr;
+        slot.fence = nullptr;
+        slot.fenceValue = 0;
+        slot.payloadHandler = nullptr;
+    });
+    m_videoFrames.Reset();
+
+    m_copyFence = nullptr;
+    m_renderCopyFence = nullptr;
+    m_copyFenceValue = 0;
+    m_isCopyFenceSupported = true;
+
+    m_displayTextureSRV = nullptr;
+    m_displayTexture = nullptr;
+    ZeroMemory(&m_displayTextureDesc, sizeof(CD3D11_TEXTURE2D_DESC));
+}
+
+
+IAsyncAction CaptureEngine::StartPreviewCoroutine(
+    uint32_t width, uint32_t height,
+    boolean enableAudio, boolean enableMrc)
+{
+    winrt::apartment_context calling_thread;
+
+    // Cancel() also cancels the async call being awaited, each co_await after it throws hresult_canceled
+    auto cancellation = co_await get_cancellation_token();
+    cancellation.enable_propagation();
+
+    co_await resume_on(*m_executor);
+
+    auto guard = m_cs.Guard();
+
+    // a warm capture can only be reused if it was initialized for the same streams
+    if (m_mediaCapture != nullptr
+        &&
+        (m_initSettings.StreamingCaptureMode() == StreamingCaptureMode::AudioAndVideo) != static_cast<bool>(enableAudio))
+    {
+        co_await ReleaseMediaCaptureAsync();
+    }
+
+    auto isWarm = m_mediaCapture != nullptr;
+
+    m_startupTimings.isWarmStart = isWarm;
+
+    // effects kept warm are reused when they match what is asked for
+    auto keepEffects = isWarm
+        && enableMrc
+        && (m_mrcPreviewEffect != nullptr || m_mrcVideoEffect != nullptr)
+        && (m_mrcAudioEffect != nullptr) == static_cast<bool>(enableAudio);
+
+    if (m_mediaCapture == nullptr)
+    {
+        co_await CreateMediaCaptureAsync(width, height, enableAudio, &m_startupTimings);
+    }
+    else if (!keepEffects)
+    {
+        co_await RemoveMrcEffectsAsync();
+    }
+
+    // set video controller properties
+    auto videoController = m_mediaCapture.VideoDeviceController();
+
+    try
+    {
+        videoController.DesiredOptimization(Windows::Media::Devices::MediaCaptureOptimization::LatencyThenQuality);
+    }
     catch (hresult_error const& er)
     {
         Log(L"DesiredOptimization failed: 0x%lx", er.code());
     }
 
-    // override video controller media stream properties
-    if (m_initSettings.SharingMode() == MediaCaptureSharingMode::ExclusiveControl)
+    auto lapStart = std::chrono::steady_clock::now();
+
+    // override video controller media stream properties, unless a warm capture is already set to this size
+    if (m_initSettings.SharingMode() == MediaCaptureSharingMode::ExclusiveControl
+        &&
+        (!isWarm || width != m_warmWidth || height != m_warmHeight))
     {
-        auto videoEncProps = GetVideoDeviceProperties(videoController, m_streamType, width, height, MediaEncodingSubtypes::Nv12());
+        auto videoEncProps = DeviceCatalog::Instance()->FindStreamProperties(videoController, m_streamType, width, height, 30.0, MediaEncodingSubtypes::Nv12());
         co_await videoController.SetMediaStreamPropertiesAsync(m_streamType, videoEncProps);
 
         auto captureSettings = m_mediaCapture.MediaCaptureSettings();
@@ -573,11 +1333,13 @@ IAsyncAction CaptureEngine::StartPreviewCoroutine(
             &&
             captureSettings.VideoDeviceCharacteristic() != VideoDeviceCharacteristic::PreviewRecordStreamsIdentical)
         {
-            videoEncProps = GetVideoDeviceProperties(videoController, MediaStreamType::VideoRecord, width, height, MediaEncodingSubtypes::Nv12());
+            videoEncProps = DeviceCatalog::Instance()->FindStreamProperties(videoController, MediaStreamType::VideoRecord, width, height, 30.0, MediaEncodingSubtypes::Nv12());
             co_await videoController.SetMediaStreamPropertiesAsync(MediaStreamType::VideoRecord, videoEncProps);
         }
     }
 
+    m_startupTimings.streamProperties = LapMicroseconds(lapStart);
+
     // encoding profile based on 720p
     auto encodingProfile = MediaEncodingProfile::CreateMp4(VideoEncodingQuality::HD720p);
     encodingProfile.Container(nullptr);
@@ -618,11 +1380,26 @@ IAsyncAction CaptureEngine::StartPreviewCoroutine(
     auto mediaSink = CameraCapture::Media::Capture::Sink(encodingProfile);
 
     // create mrc effects first
-    if (enableMrc)
+    if (enableMrc && !keepEffects)
     {
+        lapStart = std::chrono::steady_clock::now();
+
         co_await AddMrcEffectsAsync(enableAudio);
+
+        m_startupTimings.effects = LapMicroseconds(lapStart);
     }
 
+    m_warmWidth = width;
+    m_warmHeight = height;
+
+    // nothing has been started yet, the capture is kept for StopPreview to release or keep warm
+    if (cancellation())
+    {
+        co_return;
+    }
+
+    lapStart = std::chrono::steady_clock::now();
+
     if (m_streamType == MediaStreamType::VideoRecord)
     {
         co_await m_mediaCapture.StartRecordToCustomSinkAsync(encodingProfile, mediaSink);
@@ -632,6 +1409,10 @@ IAsyncAction CaptureEngine::StartPreviewCoroutine(
         co_await m_mediaCapture.StartPreviewToCustomSinkAsync(encodingProfile, mediaSink);
     }
 
+    m_startupTimings.startStream = LapMicroseconds(lapStart);
+    m_streamStarted = lapStart;
+    m_isAwaitingFirstFrame = true;
+
     // store locals
     m_mediaSink = mediaSink;
 
@@ -649,14 +1430,22 @@ IAsyncAction CaptureEngine::StopPreviewCoroutine()
 {
     winrt::apartment_context calling_thread;
 
-    co_await resume_background();
+    co_await resume_on(*m_executor);
 
     auto guard = m_cs.Guard();
 
     m_payloadEventRevoker.revoke();
 
+    if (m_payloadHandler != nullptr)
+    {
+        get_self<Media::implementation::PayloadHandler>(m_payloadHandler)->RemoveDecimation(m_videoDecimation);
+    }
+
     m_payloadHandler = nullptr;
 
+    // nothing left to grab once the stream stops
+    m_latestVideoTexture = nullptr;
+
     if (m_mediaSink != nullptr)
     {
         m_mediaSink.PayloadHandler(nullptr);
@@ -664,6 +1453,8 @@ IAsyncAction CaptureEngine::StopPreviewCoroutine()
 
     hresult hr = S_OK;
 
+    auto lapStart = std::chrono::steady_clock::now();
+
     if (m_mediaCapture != nullptr)
     {
         try
@@ -687,7 +1478,17 @@ IAsyncAction CaptureEngine::StopPreviewCoroutine()
             hr = er.code();
         }
 
-        co_await ReleaseMediaCaptureAsync();
+        m_teardownTimings.stopStream = LapMicroseconds(lapStart);
+
+        if (m_keepWarm && !m_isShutdown && SUCCEEDED(hr))
+        {
+            // keep the initialized capture, profiles and effects for the next start
+            StartIdleTimer();
+        }
+        else
+        {
+            co_await ReleaseMediaCaptureAsync();
+        }
 
         if (m_mediaSink != nullptr)
         {
@@ -699,6 +1500,20 @@ IAsyncAction CaptureEngine::StopPreviewCoroutine()
 
             m_mediaSink = nullptr;
         }
+
+        m_teardownTimings.release = LapMicroseconds(lapStart);
+    }
+
+    m_teardownTimings.total = LapMicroseconds(m_teardownBegin);
+
+    if (!m_isShutdown)
+    {
+        Log(L"StopPreview: cancel %u, stop %u, release %u, total %u us%s\n",
+            m_teardownTimings.cancel,
+            m_teardownTimings.stopStream,
+            m_teardownTimings.release,
+            m_teardownTimings.total,
+            m_teardownTimings.wasCancelled ? L" (cancelled)" : L"");
     }
 
     SetEvent(m_stopPreviewEventHandle.get());
@@ -714,92 +1529,164 @@ IAsyncAction CaptureEngine::StopPreviewCoroutine()
 IAsyncAction CaptureEngine::TakePhotoCoroutine(
     uint32_t const width,
     uint32_t const height,
+    uint32_t const count,
     boolean const enableMrc)
 {
     winrt::apartment_context calling_thread;
 
-    co_await resume_background();
+    auto cancellation = co_await get_cancellation_token();
+    cancellation.enable_propagation();
 
-    auto guard = m_cs.Guard();
+    co_await resume_on(*m_executor);
 
     auto createdCapture = false;
-    if (m_mediaCapture == nullptr)
+    auto addedEffect = false;
+    LowLagPhotoCapture photoCapture = nullptr;
+    IAsyncOperation<CapturedPhoto> captureOp = nullptr;
+
+    // a cancelled or failed burst is cleaned up below, once it has left the handler
+    std::exception_ptr failure = nullptr;
+    try
     {
-        co_await CreateMediaCaptureAsync(width, height, false);
+        {
+            auto guard = m_cs.Guard();
 
-        createdCapture = true;
-    }
+            if (m_mediaCapture == nullptr)
+            {
+                createdCapture = true;
 
-    auto captureSettings = m_mediaCapture.MediaCaptureSettings();
+                co_await CreateMediaCaptureAsync(width, height, false, nullptr);
+            }
 
-    auto characteristic = captureSettings.VideoDeviceCharacteristic();
+            auto captureSettings = m_mediaCapture.MediaCaptureSettings();
 
-    auto addedEffect = false;
-    if (enableMrc
-        &&
-        characteristic != VideoDeviceCharacteristic::AllStreamsIndependent
-        &&
-        characteristic != VideoDeviceCharacteristic::PreviewPhotoStreamsIdentical)
-    {
-        try
-        {
-            auto mrcVideoEffect = Media::Capture::MrcVideoEffect();
-            mrcVideoEffect.StreamType(MediaStreamType::Photo);
+            auto characteristic = captureSettings.VideoDeviceCharacteristic();
+
+            if (enableMrc
+                &&
+                characteristic != VideoDeviceCharacteristic::AllStreamsIndependent
+                &&
+                characteristic != VideoDeviceCharacteristic::PreviewPhotoStreamsIdentical)
+            {
+                addedEffect = true;
+
+                try
+                {
+                    auto mrcVideoEffect = Media::Capture::MrcVideoEffect();
+                    mrcVideoEffect.StreamType(MediaStreamType::Photo);
+
+                    co_await m_mediaCapture.AddVideoEffectAsync(mrcVideoEffect, MediaStreamType::Photo);
+                }
+                catch (hresult_canceled const&)
+                {
+                    throw;
+                }
+                catch (hresult_error const& error)
+                {
+                    Log(L"can't add the mrc extension - %s\n", error.message().c_str());
+                }
+            }
 
-            co_await m_mediaCapture.AddVideoEffectAsync(mrcVideoEffect, MediaStreamType::Photo);
+            // set video controller properties
+            auto videoController = m_mediaCapture.VideoDeviceController();
+
+            // override video controller media stream properties
+            if (m_initSettings.SharingMode() == MediaCaptureSharingMode::ExclusiveControl)
+            {
+                // find the closest resolution
+                auto videoEncProps = DeviceCatalog::Instance()->FindStreamProperties(videoController, MediaStreamType::Photo, width, height, 30.0, MediaEncodingSubtypes::Nv12());
+                co_await videoController.SetMediaStreamPropertiesAsync(MediaStreamType::Photo, videoEncProps);
+            }
+
+            auto photoProps = videoController.GetMediaStreamProperties(MediaStreamType::Photo).as<VideoEncodingProperties>();
+
+            // every shot of the burst gets its own buffer, the ones a smaller burst does not
+            // need are released and the others are only recreated when the size changes
+            m_photoBufferCount = count;
+            m_nextPhotoBuffer = 0;
+            m_photoBuffers.resize(m_photoBufferCount);
+
+            for (uint32_t i = 0; i < m_photoBufferCount; ++i)
+            {
+                auto& buffer = m_photoBuffers[i];
+                if (buffer.sample == nullptr
+                    ||
+                    buffer.desc.Width != photoProps.Width()
+                    ||
+                    buffer.desc.Height != photoProps.Height())
+                {
+                    IFT(CreatePhotoBuffer(photoProps.Width(), photoProps.Height(), buffer));
+                }
+            }
+
+            auto encProperties = ImageEncodingProperties::CreateUncompressed(MediaPixelFormat::Bgra8);
+            encProperties.Width(photoProps.Width());
+            encProperties.Height(photoProps.Height());
+
+            photoCapture = co_await m_mediaCapture.PrepareLowLagPhotoCaptureAsync(encProperties);
         }
-        catch (hresult_error const& error)
+
+        // m_cs is only held to copy a shot out, the shots are raised without it;
+        // the next capture is already running while the previous photo is copied out
+        captureOp = photoCapture.CaptureAsync();
+        for (uint32_t shot = 0; shot < count; ++shot)
         {
-            Log(L"can't add the mrc extension - %s\n", error.message().c_str());
-        }
+            auto capturedPhoto = co_await captureOp;
 
-        addedEffect = true;
-    }
+            auto isLastShot = shot + 1 == count;
+            if (!isLastShot)
+            {
+                captureOp = photoCapture.CaptureAsync();
+            }
 
-    // set video controller properties
-    auto videoController = m_mediaCapture.VideoDeviceController();
+            CAPTURE_STATE photoState{};
 
-    // override video controller media stream properties
-    if (m_initSettings.SharingMode() == MediaCaptureSharingMode::ExclusiveControl)
-    {
-        // find the closest resolution
-        auto videoEncProps = GetVideoDeviceProperties(videoController, MediaStreamType::Photo, width, height, MediaEncodingSubtypes::Nv12());
-        co_await videoController.SetMediaStreamPropertiesAsync(MediaStreamType::Photo, videoEncProps);
-    }
+            {
+                auto guard = m_cs.Guard();
 
-    auto photoProps = videoController.GetMediaStreamProperties(MediaStreamType::Photo).as<VideoEncodingProperties>();
+                IFT(StorePhoto(capturedPhoto, photoState));
 
-    if (m_photoSample == nullptr
-        ||
-        m_photoTextureDesc.Width != photoProps.Width()
-        ||
-        m_photoTextureDesc.Height != photoProps.Height())
-    {
-        CreatePhotoTexture(photoProps.Width(), photoProps.Height());
-    }
+                if (isLastShot)
+                {
+                    m_lastPhotoState = photoState;
+                }
+            }
 
-    auto encProperties = ImageEncodingProperties::CreateUncompressed(MediaPixelFormat::Bgra8);
-    encProperties.Width(photoProps.Width());
-    encProperties.Height(photoProps.Height());
+            if (!isLastShot)
+            {
+                CALLBACK_STATE state{};
+                ZeroMemory(&state, sizeof(CALLBACK_STATE));
+
+                state.type = CallbackType::Capture;
+                state.value.captureState = photoState;
+
+                Callback(state);
+            }
+        }
 
-    auto photoCapture = co_await m_mediaCapture.PrepareLowLagPhotoCaptureAsync(encProperties);
+        co_await photoCapture.FinishAsync();
+    }
+    catch (...)
+    {
+        failure = std::current_exception();
+    }
 
-    auto capturedPhoto = co_await photoCapture.CaptureAsync();
+    auto guard = m_cs.Guard();
 
-    com_ptr<IMFGetService> spService = capturedPhoto.Frame().try_as<IMFGetService>();
-    if (spService != nullptr)
+    if (failure != nullptr)
     {
-        com_ptr<IMFMediaType> mediaType = nullptr;
-        IFT(MFCreateMediaTypeFromProperties(winrt::get_unknown(encProperties), mediaType.put()));
+        // the shot after the one that failed may still be running
+        if (captureOp != nullptr && captureOp.Status() == AsyncStatus::Started)
+        {
+            captureOp.Cancel();
+        }
 
-        com_ptr<IMFSample> spSample = nullptr;
-        IFT(spService->GetService(MF_WRAPPED_SAMPLE_SERVICE, __uuidof(IMFSample), spSample.put_void()));
+        AbortPhotoCapture(photoCapture, addedEffect, createdCapture);
 
-        // copy the data
-        IFT(CopySample(MFMediaType_Video, spSample, m_photoSample));
-    }
+        SetEvent(m_takePhotoEventHandle.get());
 
-    co_await photoCapture.FinishAsync();
+        std::rethrow_exception(failure);
+    }
 
     if (addedEffect)
     {
@@ -813,7 +1700,12 @@ IAsyncAction CaptureEngine::TakePhotoCoroutine(
         }
     }
 
-    if (createdCapture)
+    if (m_mediaSink == nullptr && m_keepWarm && !m_isShutdown)
+    {
+        // not previewing, keep the capture until it has been idle for a while
+        StartIdleTimer();
+    }
+    else if (createdCapture)
     {
         co_await ReleaseMediaCaptureAsync();
     }
@@ -823,19 +1715,83 @@ IAsyncAction CaptureEngine::TakePhotoCoroutine(
     co_await calling_thread;
 }
 
+// undoes what a cancelled or failed TakePhotoCoroutine set up, call with m_cs held.
+// A cancelled coroutine throws at each co_await, so this waits on the calls instead
+_Use_decl_annotations_
+void CaptureEngine::AbortPhotoCapture(
+    LowLagPhotoCapture const& photoCapture,
+    boolean const clearEffects,
+    boolean const releaseCapture)
+{
+    try
+    {
+        if (photoCapture != nullptr)
+        {
+            photoCapture.FinishAsync().get();
+        }
+    }
+    catch (hresult_error const& error)
+    {
+        Log(L"can't finish the photo capture - %s\n", error.message().c_str());
+    }
+
+    if (m_mediaCapture == nullptr)
+    {
+        return;
+    }
+
+    if (clearEffects)
+    {
+        try
+        {
+            m_mediaCapture.ClearEffectsAsync(MediaStreamType::Photo).get();
+        }
+        catch (hresult_error const& error)
+        {
+            Log(L"can't clear the mrc extension - %s\n", error.message().c_str());
+        }
+    }
+
+    if (releaseCapture && m_mediaSink == nullptr)
+    {
+        try
+        {
+            ReleaseMediaCaptureAsync().get();
+        }
+        catch (hresult_error const& error)
+        {
+            Log(L"can't release the media capture - %s\n", error.message().c_str());
+        }
+    }
+}
+
 
 IAsyncAction CaptureEngine::CreateMediaCaptureAsync(
     uint32_t const& width,
     uint32_t const& height,
-    boolean const& enableAudio)
+    boolean const& enableAudio,
+    STARTUP_TIMINGS* const pTimings)
 {
     if (m_mediaCapture != nullptr)
     {
         co_return;
     }
 
-    auto audioDevice = co_await GetFirstDeviceAsync(Windows::Devices::Enumeration::DeviceClass::AudioCapture);
-    auto videoDevice = co_await GetFirstDeviceAsync(Windows::Devices::Enumeration::DeviceClass::VideoCapture);
+    STARTUP_TIMINGS timings{};
+
+    auto lapStart = std::chrono::steady_clock::now();
+
+    // devices and profiles are only enumerated on the first session or after a device change
+    auto catalog = DeviceCatalog::Instance();
+
+    // both lookups are started before either is awaited, audio only when it is used
+    auto videoDeviceOp = catalog->GetFirstDeviceAsync(Windows::Devices::Enumeration::DeviceClass::VideoCapture);
+    auto audioDeviceOp = enableAudio ? catalog->GetFirstDeviceAsync(Windows::Devices::Enumeration::DeviceClass::AudioCapture) : nullptr;
+
+    auto videoDevice = co_await videoDeviceOp;
+    auto audioDevice = audioDeviceOp != nullptr ? co_await audioDeviceOp : nullptr;
+
+    timings.deviceDiscovery = LapMicroseconds(lapStart);
 
     // initialize settings
     auto initSettings = MediaCaptureInitializationSettings();
@@ -863,62 +1819,23 @@ IAsyncAction CaptureEngine::CreateMediaCaptureAsync(
     IFT(advancedInitSettings->SetDirectxDeviceManager(m_dxgiDeviceManager.get()));
 
     // if profiles are supported
-    if (MediaCapture::IsVideoProfileSupported(videoDevice.Id()))
+    if (catalog->IsVideoProfileSupported(videoDevice.Id()))
     {
         initSettings.SharingMode(MediaCaptureSharingMode::SharedReadOnly);
 
-        setlocale(LC_ALL, "");
-
-        // set the profile / mediaDescription that matches
+        // set the profile / mediaDescription that is closest to width/height @ 30fps,
+        // final size will be set with enc props
         MediaCaptureVideoProfile videoProfile = nullptr;
         MediaCaptureVideoProfileMediaDescription videoProfileMediaDescription = nullptr;
-        auto profiles = MediaCapture::FindKnownVideoProfiles(videoDevice.Id(), m_videoProfile);
-        for (auto const& profile : profiles)
+        double score = 0.0;
+        if (catalog->FindVideoProfile(videoDevice.Id(), m_videoProfile, m_streamType, width, height, 30.0, MediaEncodingSubtypes::Nv12(), videoProfile, videoProfileMediaDescription, score))
         {
-            auto const& videoProfileMediaDescriptions = m_streamType == (MediaStreamType::VideoPreview) ? profile.SupportedPreviewMediaDescription() : profile.SupportedRecordMediaDescription();
-            auto const& found = std::find_if(begin(videoProfileMediaDescriptions), end(videoProfileMediaDescriptions), [&](MediaCaptureVideoProfileMediaDescription const& desc)
-                {
-                    Log(L"\tFormat: %s: %i x %i @ %f fps",
-                        desc.Subtype().c_str(),
-                        desc.Width(),
-                        desc.Height(),
-                        desc.FrameRate());
-
-                    // store a default
-                    if (videoProfile == nullptr)
-                    {
-                        videoProfile = profile;
-                    }
-
-                    if (videoProfileMediaDescription == nullptr)
-                    {
-                        videoProfileMediaDescription = desc;
-                    }
-
-                    // select a size that will be == width/height @ 30fps, final size will be set with enc props
-                    bool match =
-                        _wcsicmp(desc.Subtype().c_str(), MediaEncodingSubtypes::Nv12().c_str()) == 0 &&
-                        desc.Width() == width &&
-                        desc.Height() == height &&
-                        desc.FrameRate() == 30.0;
-                    if (match)
-                    {
-                        Log(L" - found\n");
-                    }
-                    else
-                    {
-                        Log(L"\n");
-                    }
-
-                    return match;
-                });
-
-            if (found != end(videoProfileMediaDescriptions))
-            {
-                videoProfile = profile;
-                videoProfileMediaDescription = *found;
-                break;
-            }
+            Log(L"Selected video profile %i x %i @ %f fps %s, score %f\n",
+                videoProfileMediaDescription.Width(),
+                videoProfileMediaDescription.Height(),
+                videoProfileMediaDescription.FrameRate(),
+                videoProfileMediaDescription.Subtype().c_str(),
+                score);
         }
 
         initSettings.VideoProfile(videoProfile);
@@ -937,11 +1854,22 @@ IAsyncAction CaptureEngine::CreateMediaCaptureAsync(
         initSettings.SharingMode(MediaCaptureSharingMode::ExclusiveControl);
     }
 
+    timings.formatSelection = LapMicroseconds(lapStart);
+
     auto mediaCapture = Windows::Media::Capture::MediaCapture();
     co_await mediaCapture.InitializeAsync(initSettings);
 
+    timings.initialize = LapMicroseconds(lapStart);
+
     m_mediaCapture = mediaCapture;
     m_initSettings = initSettings;
+
+    if (pTimings != nullptr)
+    {
+        pTimings->deviceDiscovery = timings.deviceDiscovery;
+        pTimings->formatSelection = timings.formatSelection;
+        pTimings->initialize = timings.initialize;
+    }
 }
 
 IAsyncAction CaptureEngine::ReleaseMediaCaptureAsync()
@@ -963,6 +1891,79 @@ IAsyncAction CaptureEngine::ReleaseMediaCaptureAsync()
     m_mediaCapture.Close();
 
     m_mediaCapture = nullptr;
+
+    m_warmWidth = 0;
+    m_warmHeight = 0;
+}
+
+// call with m_cs held
+void CaptureEngine::StartIdleTimer()
+{
+    CancelIdleTimer();
+
+    if (m_idleTimeoutMs == 0)
+    {
+        return;
+    }
+
+    auto idleGeneration = m_idleGeneration;
+
+    m_idleTimer = ThreadPoolTimer::CreateTimer([weak = get_weak(), idleGeneration](ThreadPoolTimer const&)
+    {
+        auto strong = weak.get();
+        if (strong != nullptr)
+        {
+            strong->ReleaseIdleCaptureAsync(idleGeneration);
+        }
+    }, std::chrono::milliseconds(m_idleTimeoutMs));
+}
+
+// call with m_cs held, a timer that already fired sees the generation change and does nothing
+void CaptureEngine::CancelIdleTimer()
+{
+    ++m_idleGeneration;
+
+    if (m_idleTimer != nullptr)
+    {
+        m_idleTimer.Cancel();
+
+        m_idleTimer = nullptr;
+    }
+}
+
+fire_and_forget CaptureEngine::ReleaseIdleCaptureAsync(
+    uint32_t const idleGeneration)
+{
+    auto strong = get_strong();
+
+    co_await resume_on(*m_executor);
+
+    auto guard = m_cs.Guard();
+
+    // restarted, replaced or torn down since the timer was armed
+    if (m_isShutdown
+        ||
+        idleGeneration != m_idleGeneration
+        ||
+        m_mediaSink != nullptr
+        ||
+        m_startPreviewOp != nullptr
+        ||
+        m_takePhotoOp != nullptr)
+    {
+        co_return;
+    }
+
+    m_idleTimer = nullptr;
+
+    try
+    {
+        co_await ReleaseMediaCaptureAsync();
+    }
+    catch (hresult_error const& er)
+    {
+        Log(L"releasing idle capture failed: %s\n", er.message().c_str());
+    }
 }
 
 
@@ -1043,7 +2044,53 @@ IAsyncAction CaptureEngine::RemoveMrcEffectsAsync()
     }
 }
 
-hresult CaptureEngine::CreatePhotoTexture(uint32_t width, uint32_t height)
+// copies a captured photo into the next pool buffer, call with m_cs held
+_Use_decl_annotations_
+hresult CaptureEngine::StorePhoto(
+    CapturedPhoto const& capturedPhoto,
+    CAPTURE_STATE& state)
+{
+    ZeroMemory(&state, sizeof(CAPTURE_STATE));
+
+    NULL_CHK_HR(capturedPhoto, E_INVALIDARG);
+
+    if (m_photoBufferCount == 0)
+    {
+        IFR(MF_E_INVALIDREQUEST);
+    }
+
+    auto& buffer = m_photoBuffers[m_nextPhotoBuffer];
+    m_nextPhotoBuffer = (m_nextPhotoBuffer + 1) % m_photoBufferCount;
+
+    com_ptr<IMFGetService> spService = capturedPhoto.Frame().try_as<IMFGetService>();
+    if (spService != nullptr)
+    {
+        com_ptr<IMFSample> spSample = nullptr;
+        IFR(spService->GetService(MF_WRAPPED_SAMPLE_SERVICE, __uuidof(IMFSample), spSample.put_void()));
+
+        // copy the data
+        IFR(CopySample(MFMediaType_Video, spSample, buffer.sample));
+
+        LONGLONG sampleTime = 0;
+        if (SUCCEEDED(spSample->GetSampleTime(&sampleTime)))
+        {
+            state.timestamp = sampleTime;
+        }
+    }
+
+    state.stateType = CaptureStateType::PhotoFrame;
+    state.width = buffer.desc.Width;
+    state.height = buffer.desc.Height;
+    state.texturePtr = buffer.textureSRV.get();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+hresult CaptureEngine::CreatePhotoBuffer(
+    uint32_t width,
+    uint32_t height,
+    PhotoBuffer& buffer)
 {
     auto resources = m_d3d11DeviceResources.lock();
     NULL_CHK_HR(resources, MF_E_UNEXPECTED);
@@ -1075,10 +2122,10 @@ hresult CaptureEngine::CreatePhotoTexture(uint32_t width, uint32_t height)
 
     IFR(mediaSample->AddBuffer(dxgiMediaBuffer.get()));
 
-    m_photoTextureDesc = desc;
-    m_photoTexture = photoTexture;
-    m_photoTextureSRV = srv;
-    m_photoSample = mediaSample;
+    buffer.desc = desc;
+    buffer.texture = photoTexture;
+    buffer.textureSRV = srv;
+    buffer.sample = mediaSample;
 
     return S_OK;
 }
\ No newline at end of file
@@ -9,14 +9,28 @@
 #include "Media.SharedTexture.h"
 #include "Media.Capture.Sink.h"
 #include "Media.Transform.h"
+#include "Media.Executor.h"
+#include "Media.TripleBuffer.h"
+#include "Media.FrameLatency.h"
 
 #include <mfapi.h>
+#include <d3d11_4.h>
 #include <winrt/windows.media.h>
 #include <winrt/Windows.Media.Capture.h>
+#include <winrt/Windows.System.Threading.h>
+
+#include <chrono>
+
+struct __declspec(uuid("013a4396-deb9-48db-a337-f3c82f511d25")) ICaptureEnginePriv : ::IUnknown
+{
+    virtual winrt::hresult __stdcall GetStartupTimings(_Out_ STARTUP_TIMINGS* pTimings) = 0;
+    virtual winrt::hresult __stdcall GetTeardownTimings(_Out_ TEARDOWN_TIMINGS* pTimings) = 0;
+    virtual winrt::hresult __stdcall GrabFrame(_Out_ CAPTURE_STATE* pState) = 0;
+};
 
 namespace winrt::CameraCapture::Plugin::implementation
 {
-    struct CaptureEngine : CaptureEngineT<CaptureEngine, Module>
+    struct CaptureEngine : CaptureEngineT<CaptureEngine, Module, ICaptureEnginePriv>
     {
         static Plugin::Module Create(
             _In_ std::weak_ptr<IUnityDeviceResource> const& unityDevice,
@@ -27,37 +41,111 @@ namespace winrt::CameraCapture::Plugin::implementation
         ~CaptureEngine() { Shutdown(); }
 
         virtual void Shutdown() override;
+        virtual void OnRenderEvent(uint16_t frameNumber) override;
 
         hresult StartPreview(uint32_t width, uint32_t height, bool enableAudio, bool enableMrc);
         hresult StopPreview();
         hresult TakePhoto(uint32_t width, uint32_t height, bool enableMrc);
 
+        // takes count photos with one prepared low lag capture, each raises PhotoFrame;
+        // every shot has its own texture until the next TakePhoto/TakePhotoBurst, up to
+        // MaxBurstCount shots
+        hresult TakePhotoBurst(uint32_t width, uint32_t height, uint32_t count, bool enableMrc);
+
+        // when enabled video frames are handed to the render thread through a triple
+        // buffer and copied into a stable texture from OnRenderEvent
+        hresult TripleBuffering(bool enable);
+
+        // when enabled StopPreview only stops streaming, the initialized MediaCapture,
+        // stream properties and MRC effects are kept for the next StartPreview/TakePhoto
+        // and released after idleTimeoutMs without use (0 keeps them until Shutdown)
+        hresult KeepWarm(bool enable, uint32_t idleTimeoutMs);
+
+        // video frames this capture hands to Unity, every frameInterval-th frame or paced
+        // to targetFrameRate, 0 for both delivers every frame; other subscribers of the
+        // payload handler decimate on their own
+        hresult FrameDecimation(uint32_t frameInterval, double targetFrameRate);
+
         CameraCapture::Media::Capture::Sink MediaSink();
 
         CameraCapture::Media::PayloadHandler PayloadHandler();
         void PayloadHandler(CameraCapture::Media::PayloadHandler const& value);
 
+        // ICaptureEnginePriv
+        virtual hresult __stdcall GetStartupTimings(_Out_ STARTUP_TIMINGS* pTimings) override;
+        virtual hresult __stdcall GetTeardownTimings(_Out_ TEARDOWN_TIMINGS* pTimings) override;
+
+        // copies the newest preview frame into a photo buffer and returns its PhotoFrame
+        // state, fails with MF_E_INVALIDREQUEST when no frame has arrived
+        virtual hresult __stdcall GrabFrame(_Out_ CAPTURE_STATE* pState) override;
 
     private:
+        static constexpr uint32_t MaxBurstCount = 20;
+
+        struct PhotoBuffer
+        {
+            CD3D11_TEXTURE2D_DESC desc;
+            com_ptr<ID3D11Texture2D> texture;
+            com_ptr<ID3D11ShaderResourceView> textureSRV;
+            com_ptr<IMFSample> sample;
+        };
+
+        // a triple buffered video frame; the copy into texture was queued on the media device,
+        // the render device waits for fenceValue on fence before reading it (no fence if the
+        // copy already finished). The handler that delivered it travels with the frame so the
+        // render thread never reads m_payloadHandler, which is guarded by m_cs
+        struct VideoFrameSlot
+        {
+            com_ptr<SharedTexture> texture;
+            CAPTURE_STATE state;
+            com_ptr<ID3D11Fence> fence;
+            uint64_t fenceValue;
+            Media::PayloadHandler payloadHandler{ nullptr };
+        };
+
         hresult CreateDeviceResources();
         void ReleaseDeviceResources();
 
         Windows::Foundation::IAsyncAction StartPreviewCoroutine(uint32_t const width, uint32_t const height, boolean const enableAudio, boolean const enableMrc);
         Windows::Foundation::IAsyncAction StopPreviewCoroutine();
-        Windows::Foundation::IAsyncAction TakePhotoCoroutine(uint32_t const width, uint32_t const height, boolean const enableMrc);
+        Windows::Foundation::IAsyncAction TakePhotoCoroutine(uint32_t const width, uint32_t const height, uint32_t const count, boolean const enableMrc);
+        void AbortPhotoCapture(_In_ Windows::Media::Capture::LowLagPhotoCapture const& photoCapture, _In_ boolean const clearEffects, _In_ boolean const releaseCapture);
 
-        Windows::Foundation::IAsyncAction CreateMediaCaptureAsync(uint32_t const& width, uint32_t const& height, boolean const& enableAudio);
+        Windows::Foundation::IAsyncAction CreateMediaCaptureAsync(uint32_t const& width, uint32_t const& height, boolean const& enableAudio, STARTUP_TIMINGS* const pTimings);
         Windows::Foundation::IAsyncAction ReleaseMediaCaptureAsync();
 
         Windows::Foundation::IAsyncAction AddMrcEffectsAsync(boolean const enableAudio);
         Windows::Foundation::IAsyncAction RemoveMrcEffectsAsync();
 
-        hresult CreatePhotoTexture(uint32_t width, uint32_t height);
+        hresult CreatePhotoBuffer(uint32_t width, uint32_t height, PhotoBuffer& buffer);
+        hresult StorePhoto(Windows::Media::Capture::CapturedPhoto const& capturedPhoto, CAPTURE_STATE& state);
+
+        void StartIdleTimer();
+        void CancelIdleTimer();
+        fire_and_forget ReleaseIdleCaptureAsync(uint32_t const idleGeneration);
+
+        hresult PublishVideoFrame(
+            Media::PayloadHandler const& payloadHandler,
+            std::shared_ptr<ID3D11DeviceResource> const& resources,
+            com_ptr<IMFDXGIDeviceManager> const& dxgiDeviceManager,
+            Media::Payload const& payload,
+            com_ptr<IMFSample> const& sample);
+        hresult PresentVideoFrame(CAPTURE_STATE& state, Media::PayloadHandler& payloadHandler);
+        hresult SyncVideoFrame(
+            _In_ com_ptr<ID3D11Device> const& renderDevice,
+            _Inout_ VideoFrameSlot& slot);
+        static bool EstimateFramePose(
+            _In_ Media::PayloadHandler const& payloadHandler,
+            _Inout_ CAPTURE_STATE& state);
+        void ReleaseVideoFrames();
+
+        void SetLatestVideoFrame(com_ptr<SharedTexture> const& texture, CAPTURE_STATE const& state);
 
     private:
         CriticalSection m_cs;
 
         std::atomic<boolean> m_isShutdown;
+        std::shared_ptr<IExecutor> m_executor;
         winrt::handle m_startPreviewEventHandle;
         winrt::handle m_stopPreviewEventHandle;
         winrt::handle m_takePhotoEventHandle;
@@ -82,20 +170,62 @@ namespace winrt::CameraCapture::Plugin::implementation
         Windows::Media::IMediaExtension m_mrcVideoEffect;
         Windows::Media::IMediaExtension m_mrcPreviewEffect;
 
+        // keep warm
+        boolean m_keepWarm;
+        uint32_t m_idleTimeoutMs;
+        uint32_t m_idleGeneration;
+        Windows::System::Threading::ThreadPoolTimer m_idleTimer;
+        uint32_t m_warmWidth;
+        uint32_t m_warmHeight;
+
+        // start up instrumentation, firstFrame and total are filled in by the payload thread
+        STARTUP_TIMINGS m_startupTimings;
+        std::chrono::steady_clock::time_point m_startupBegin;
+        std::chrono::steady_clock::time_point m_streamStarted;
+        boolean m_isAwaitingFirstFrame;
+        TEARDOWN_TIMINGS m_teardownTimings;
+        std::chrono::steady_clock::time_point m_teardownBegin;
+
         // IMFMediaSink
         Media::Capture::Sink m_mediaSink;
 
         Media::PayloadHandler m_payloadHandler;
         Media::PayloadHandler::OnStreamPayload_revoker m_payloadEventRevoker;
+        std::shared_ptr<SubscriberDecimation> m_videoDecimation;
 
         // buffers
         com_ptr<IMFSample> m_audioSample;
         com_ptr<SharedTexture> m_sharedVideoTexture;
 
-        CD3D11_TEXTURE2D_DESC m_photoTextureDesc;
-        com_ptr<ID3D11Texture2D> m_photoTexture;
-        com_ptr<ID3D11ShaderResourceView> m_photoTextureSRV;
-        com_ptr<IMFSample> m_photoSample;
+        // triple buffered video, written by the payload thread, read by the render thread
+        std::atomic<boolean> m_isTripleBuffered;
+        std::atomic<int64_t> m_renderDeviceTimestamp; // newest frame not yet seen by a render event
+        CriticalSection m_renderCs; // only taken by the render thread and teardown
+        CriticalSection m_publishCs; // only taken by the payload thread and teardown, before m_renderCs
+        TripleBuffer<VideoFrameSlot> m_videoFrames;
+        com_ptr<ID3D11Fence> m_copyFence; // media device side, signalled after each copy
+        com_ptr<ID3D11Fence> m_renderCopyFence; // the same fence opened on the Unity device
+        uint64_t m_copyFenceValue;
+        boolean m_isCopyFenceSupported;
+        uint16_t m_lastRenderFrameId;
+        CD3D11_TEXTURE2D_DESC m_displayTextureDesc;
+        com_ptr<ID3D11Texture2D> m_displayTexture;
+        com_ptr<ID3D11ShaderResourceView> m_displayTextureSRV;
+
+        // grab frame, the texture the newest preview frame was copied to is kept under m_cs.
+        // The payload thread holds m_grabCs while it writes a frame and makes it the latest,
+        // GrabFrame while it copies the latest, so the pixels and the state are the same
+        // frame's. Taken before m_publishCs and m_cs, never while holding m_cs
+        com_ptr<SharedTexture> m_latestVideoTexture;
+        CAPTURE_STATE m_latestVideoState;
+        CriticalSection m_grabCs;
+        com_ptr<SharedTexture> m_grabTexture;
+
+        // one buffer per shot of the last burst, the last shot is reported when the operation completes
+        std::vector<PhotoBuffer> m_photoBuffers;
+        uint32_t m_photoBufferCount;
+        uint32_t m_nextPhotoBuffer;
+        CAPTURE_STATE m_lastPhotoState;
     };
 }
 
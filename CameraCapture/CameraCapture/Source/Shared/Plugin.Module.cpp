@@ -4,16 +4,38 @@
 #include "pch.h"
 #include "Plugin.Module.h"
 #include "Plugin.Module.g.cpp"
+#include "Media.FrameLatency.h"
 
 using namespace winrt;
 using namespace CameraCapture::Plugin::implementation;
 using namespace Windows::Foundation;
 
+// only the newest preview frame of each stream is worth delivering
+static bool IsCoalesced(
+    _In_ CALLBACK_STATE const& state)
+{
+    return state.type == CallbackType::Capture
+        && (state.value.captureState.stateType == CaptureStateType::PreviewVideoFrame
+            || state.value.captureState.stateType == CaptureStateType::PreviewAudioFrame);
+}
+
+static void RecordCallbackLatency(
+    _In_ CALLBACK_STATE const& state)
+{
+    if (state.type == CallbackType::Capture
+        && state.value.captureState.stateType == CaptureStateType::PreviewVideoFrame)
+    {
+        FrameLatency::Instance()->Record(LatencyStage::Callback, state.value.captureState.deviceTimestamp);
+    }
+}
+
 _Use_decl_annotations_
 void Module::Shutdown()
 {
     auto gurad = m_cs.Guard();
 
+    m_pendingStates.clear();
+
     m_deviceResources.reset();
     m_d3d11DeviceResources.reset();
 }
@@ -22,9 +44,38 @@ _Use_decl_annotations_
 void Module::OnRenderEvent(
     uint16_t frameNumber)
 {
-    auto gurad = m_cs.Guard();
-
     UNREFERENCED_PARAMETER(frameNumber);
+
+    StateChangedCallback stateCallback = nullptr;
+    void* pClientObject = nullptr;
+
+    {
+        auto gurad = m_cs.Guard();
+
+        if (m_pendingStates.empty())
+        {
+            return;
+        }
+
+        // swap so new states can be queued while these are delivered
+        m_deliveringStates.swap(m_pendingStates);
+
+        stateCallback = m_stateCallbacks;
+        pClientObject = m_pClientObject;
+    }
+
+    // invoke outside the lock, the client may call back into the module
+    if (stateCallback != nullptr)
+    {
+        for (auto&& state : m_deliveringStates)
+        {
+            RecordCallbackLatency(state);
+
+            stateCallback(pClientObject, state);
+        }
+    }
+
+    m_deliveringStates.clear();
 }
 
 _Use_decl_annotations_
@@ -57,11 +108,61 @@ hresult Module::Callback(
 
     NULL_CHK_HR(m_stateCallbacks, S_OK);
 
+    if (m_callbackDelivery == CallbackDelivery::RenderEvent)
+    {
+        // a newer audio or video frame supersedes one that was not delivered yet, it moves
+        // to the end so it stays ordered after any state queued in between
+        if (IsCoalesced(state))
+        {
+            auto it = std::find_if(m_pendingStates.begin(), m_pendingStates.end(), [&state](CALLBACK_STATE const& pending)
+            {
+                return pending.type == CallbackType::Capture
+                    && pending.value.captureState.stateType == state.value.captureState.stateType;
+            });
+            if (it != m_pendingStates.end())
+            {
+                m_pendingStates.erase(it);
+            }
+        }
+
+        // nobody is draining the mailbox, keep the newest states
+        if (m_pendingStates.size() >= MaxPendingStates)
+        {
+            Log(L"Callback mailbox full, dropping the oldest state\n");
+
+            m_pendingStates.erase(m_pendingStates.begin());
+        }
+
+        m_pendingStates.push_back(state);
+
+        return S_OK;
+    }
+
+    RecordCallbackLatency(state);
+
     m_stateCallbacks(m_pClientObject, state);
 
     return S_OK;
 }
 
+_Use_decl_annotations_
+hresult Module::SetCallbackDelivery(
+    CallbackDelivery delivery)
+{
+    if (delivery != CallbackDelivery::Immediate && delivery != CallbackDelivery::RenderEvent)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    auto gurad = m_cs.Guard();
+
+    // anything already queued is still delivered by the next OnRenderEvent
+    m_callbackDelivery = delivery;
+
+    return S_OK;
+}
+
+// failures are always delivered immediately, there may not be another render event
 _Use_decl_annotations_
 hresult Module::Failed(hresult hr)
 {
@@ -11,6 +11,7 @@ struct __declspec(uuid("34fe2ecf-68d3-4732-a05a-2a737b63c386")) IModulePriv : ::
     virtual winrt::hresult __stdcall Initialize(_In_ std::weak_ptr<IUnityDeviceResource> const& unityDevice, _In_ StateChangedCallback stateCallback, _In_ void* pCallbackObject) = 0;
     virtual winrt::hresult __stdcall Callback(_In_ CALLBACK_STATE state) = 0;
     virtual winrt::hresult __stdcall Failed(winrt::hresult hr) = 0;
+    virtual winrt::hresult __stdcall SetCallbackDelivery(_In_ CallbackDelivery delivery) = 0;
 };
 
 namespace winrt::CameraCapture::Plugin::implementation
@@ -26,14 +27,23 @@ namespace winrt::CameraCapture::Plugin::implementation
         virtual hresult __stdcall Initialize(_In_ std::weak_ptr<IUnityDeviceResource> const& unityDevice, _In_ StateChangedCallback stateCallback, _In_ void* pCallbackObject) override;
         virtual hresult __stdcall Callback(_In_ CALLBACK_STATE state) override;
         virtual hresult __stdcall Failed(winrt::hresult hr) override;
+        virtual hresult __stdcall SetCallbackDelivery(_In_ CallbackDelivery delivery) override;
 
     protected:
         std::weak_ptr<IUnityDeviceResource> m_deviceResources;
         std::weak_ptr<ID3D11DeviceResource> m_d3d11DeviceResources;
 
     private:
+        // render events can stop (the app is paused), the oldest states are dropped past this
+        static constexpr size_t MaxPendingStates = 64;
+
         CriticalSection m_cs;
         void* m_pClientObject;
         StateChangedCallback m_stateCallbacks;
+
+        // mailbox drained by OnRenderEvent when delivery is CallbackDelivery::RenderEvent
+        CallbackDelivery m_callbackDelivery = CallbackDelivery::Immediate;
+        std::vector<CALLBACK_STATE> m_pendingStates;
+        std::vector<CALLBACK_STATE> m_deliveringStates;
     };
 }
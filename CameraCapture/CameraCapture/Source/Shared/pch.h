@@ -156,6 +156,12 @@ typedef enum class _CallbackType : int32_t
     Capture,
 } CallbackType;
 
+typedef enum class _CallbackDelivery : int32_t
+{
+    Immediate = 0,  // invoked on the thread that produced the state
+    RenderEvent     // queued and invoked from OnRenderEvent, only the latest video frame is kept
+} CallbackDelivery;
+
 typedef struct _FAILED_STATE
 {
     int32_t hresult;
@@ -171,6 +177,13 @@ typedef enum class _CaptureStateType : int32_t
     PhotoFrame
 } CaptureStateType;
 
+// flags of a video frame in CAPTURE_STATE, also set on its sample as MF_PAYLOAD_FRAME_FLAGS
+typedef enum class _FrameFlags : uint32_t
+{
+    None = 0,
+    Redundant = 0x1,    // barely differs from the last frame that was not redundant
+} FrameFlags;
+
 typedef struct _CAPTURE_STATE
 {
     CaptureStateType stateType;
@@ -179,6 +192,9 @@ typedef struct _CAPTURE_STATE
     void* texturePtr;
     winrt::Windows::Foundation::Numerics::float4x4 worldMatrix;
     winrt::Windows::Foundation::Numerics::float4x4 projectionMatrix;
+    int64_t timestamp;  // sample time in 100ns units, 0 if unknown
+    int64_t deviceTimestamp;    // QPC time in 100ns units the device captured the frame at, 0 if unknown
+    uint32_t flags;             // FrameFlags
 } CAPTURE_STATE;
 
 #pragma pack(push, 4)
@@ -193,4 +209,92 @@ typedef struct _CALLBACK_STATE
 } CALLBACK_STATE;
 #pragma pack(pop)
 
+// duration of each StartPreview phase in microseconds, 0 if the phase was skipped
+#pragma pack(push, 4)
+typedef struct _STARTUP_TIMINGS
+{
+    uint32_t deviceDiscovery;   // audio and video device lookup, run concurrently
+    uint32_t formatSelection;   // profile and media description lookup
+    uint32_t initialize;        // MediaCapture::InitializeAsync
+    uint32_t streamProperties;  // SetMediaStreamPropertiesAsync
+    uint32_t effects;           // adding the MRC effects
+    uint32_t startStream;       // StartPreview/StartRecordToCustomSinkAsync
+    uint32_t firstFrame;        // from the stream starting to the first video payload
+    uint32_t total;             // from StartPreview to the first video payload
+    int32_t isWarmStart;        // the MediaCapture was kept warm and reused
+} STARTUP_TIMINGS;
+#pragma pack(pop)
+
+// duration of the last StopPreview or Shutdown in microseconds
+#pragma pack(push, 4)
+typedef struct _TEARDOWN_TIMINGS
+{
+    uint32_t cancel;            // cancelling a running StartPreview/TakePhoto and waiting for it to unwind
+    uint32_t stopStream;        // StopPreview/StopRecordAsync
+    uint32_t release;           // closing the MediaCapture, effects and sink
+    uint32_t total;             // from the call to the capture being stopped
+    int32_t wasCancelled;       // a running operation was cancelled
+} TEARDOWN_TIMINGS;
+#pragma pack(pop)
+
+// where a video frame's latency from capture is measured
+typedef enum class _LatencyStage : int32_t
+{
+    SinkArrival = 0,    // the sample reached the stream sink
+    Dequeue,            // the payload was taken off the dispatch queue
+    CopyDone,           // the frame was copied into the shared texture
+    Callback,           // the PreviewVideoFrame callback was invoked
+    RenderEvent,        // the texture was handed to Unity on the render thread
+    Count
+} LatencyStage;
+
+// latency from MFSampleExtension_DeviceTimestamp in microseconds
+#pragma pack(push, 4)
+typedef struct _LATENCY_STATS
+{
+    uint64_t count;
+    uint32_t minimum;
+    uint32_t maximum;
+    uint32_t mean;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+} LATENCY_STATS;
+#pragma pack(pop)
+
+// calibration of the camera the frames come from, read in place through the pointer
+// from CaptureGetCameraCalibration. The change count is odd while the block is
+// written and 0 until the first calibrated frame; readers copy the block and keep
+// the copy if the count was even and is unchanged afterwards, so a count equal
+// to the last one read means there is nothing new.
+#define CAMERA_CALIBRATION_VERSION 1
+
+#pragma pack(push, 4)
+typedef struct _CAMERA_CALIBRATION
+{
+    uint32_t version;           // CAMERA_CALIBRATION_VERSION
+    uint32_t size;              // sizeof(CAMERA_CALIBRATION), later versions only append
+    volatile int32_t changeCount;
+    uint32_t width;             // of the image the intrinsics are for
+    uint32_t height;
+    winrt::Windows::Foundation::Numerics::float2 focalLength;       // in pixels
+    winrt::Windows::Foundation::Numerics::float2 principalPoint;    // in pixels
+    winrt::Windows::Foundation::Numerics::float3 radialDistortion;  // k1, k2, k3
+    winrt::Windows::Foundation::Numerics::float2 tangentialDistortion;  // p1, p2
+    winrt::Windows::Foundation::Numerics::float3 extrinsicPosition;     // of the camera in its calibration node
+    winrt::Windows::Foundation::Numerics::quaternion extrinsicOrientation;
+    GUID calibrationId;         // the node the extrinsics are relative to
+    uint32_t reserved;
+    int64_t sampleTime;         // sample time in 100ns units of the first frame with this calibration
+    int64_t deviceTimestamp;    // QPC time in 100ns units of the first frame with this calibration
+} CAMERA_CALIBRATION;
+#pragma pack(pop)
+
+// how a camera pose is extrapolated past the newest frame
+typedef enum class _PosePrediction : int32_t
+{
+    ConstantVelocity = 0,   // linear and angular velocity
+    ConstantAcceleration    // also linear and angular acceleration, noisier
+} PosePrediction;
+
 extern "C" typedef void(__stdcall *StateChangedCallback)(_In_ void* callbackObject, _In_ CALLBACK_STATE args);
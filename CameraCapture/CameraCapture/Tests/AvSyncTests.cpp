@@ -0,0 +1,303 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// pairs synthetic 30 fps video with 10ms audio blocks (100ns units), payloads are
+// stood in for by their index
+
+#include "Media.AvSync.h"
+
+#include "TestHelpers.h"
+
+static constexpr int64_t FramePeriod = 333333;
+static constexpr int64_t BlockDuration = 100000;
+
+// the device clock runs far from the presentation clock, pairing on the wrong one fails
+static constexpr int64_t DeviceOffset = 50000000000;
+
+static AvTimestamp VideoTime(int64_t frame, int64_t duration = 0)
+{
+    auto sampleTime = frame * FramePeriod;
+
+    return { sampleTime, duration, sampleTime + DeviceOffset, true };
+}
+
+static AvTimestamp AudioTime(int64_t block, bool hasDeviceTime = true)
+{
+    auto sampleTime = block * BlockDuration;
+
+    return { sampleTime, BlockDuration, hasDeviceTime ? sampleTime + DeviceOffset : 0, hasDeviceTime };
+}
+
+using Bundles = std::vector<AvBundle<int>>;
+
+static void Drain(AvSynchronizer<int>& sync, Bundles& bundles)
+{
+    sync.Drain([&bundles](AvBundle<int>&& bundle) { bundles.push_back(std::move(bundle)); });
+}
+
+static void Flush(AvSynchronizer<int>& sync, Bundles& bundles)
+{
+    sync.Flush([&bundles](AvBundle<int>&& bundle) { bundles.push_back(std::move(bundle)); });
+}
+
+static void InOrderAudioIsPairedWithItsFrame()
+{
+    AvSynchronizer<int> sync;
+    Bundles bundles;
+
+    sync.PushVideo(0, VideoTime(0));
+    for (int block = 0; block < 4; ++block)
+    {
+        sync.PushAudio(block, AudioTime(block));
+    }
+
+    // the interval of frame 0 is unknown until frame 1 arrives
+    Drain(sync, bundles);
+    CHECK(bundles.empty());
+
+    sync.PushVideo(1, VideoTime(1));
+    Drain(sync, bundles);
+
+    CHECK(bundles.size() == 1);
+    if (bundles.size() == 1)
+    {
+        CHECK(bundles[0].video == 0);
+        CHECK(bundles[0].isComplete);
+        CHECK(bundles[0].intervalDuration == FramePeriod);
+
+        // blocks 0 to 3 start before frame 1
+        CHECK((bundles[0].audio == std::vector<int>{ 0, 1, 2, 3 }));
+    }
+
+    // frame 1 waits until the audio has reached frame 2
+    sync.PushVideo(2, VideoTime(2));
+    Drain(sync, bundles);
+    CHECK(bundles.size() == 1);
+
+    for (int block = 4; block < 7; ++block)
+    {
+        sync.PushAudio(block, AudioTime(block));
+    }
+    Drain(sync, bundles);
+
+    CHECK(bundles.size() == 2);
+    if (bundles.size() == 2)
+    {
+        CHECK(bundles[1].video == 1);
+        CHECK(bundles[1].isComplete);
+        CHECK((bundles[1].audio == std::vector<int>{ 4, 5, 6 }));
+    }
+
+    CHECK(sync.DroppedAudioCount() == 0);
+}
+
+static void LateAudioIsReordered()
+{
+    AvSynchronizer<int> sync;
+    Bundles bundles;
+
+    sync.PushVideo(0, VideoTime(0));
+    sync.PushAudio(0, AudioTime(0));
+    sync.PushAudio(2, AudioTime(2));
+    sync.PushAudio(3, AudioTime(3));
+    sync.PushAudio(1, AudioTime(1));
+    sync.PushVideo(1, VideoTime(1));
+    Drain(sync, bundles);
+
+    CHECK(bundles.size() == 1);
+    if (bundles.size() == 1)
+    {
+        CHECK((bundles[0].audio == std::vector<int>{ 0, 1, 2, 3 }));
+        CHECK(bundles[0].audioTimes.size() == 4);
+    }
+
+    // a block of frame 0 arriving after it was released has no frame left to go with
+    sync.PushAudio(1, AudioTime(1));
+    for (int block = 4; block < 7; ++block)
+    {
+        sync.PushAudio(block, AudioTime(block));
+    }
+    sync.PushVideo(2, VideoTime(2));
+    Drain(sync, bundles);
+
+    CHECK(bundles.size() == 2);
+    if (bundles.size() == 2)
+    {
+        CHECK((bundles[1].audio == std::vector<int>{ 4, 5, 6 }));
+    }
+    CHECK(sync.DroppedAudioCount() == 1);
+}
+
+static void MissingDeviceTimeFallsBackToSampleTimes()
+{
+    AvSynchronizer<int> sync;
+    Bundles bundles;
+
+    sync.PushVideo(0, VideoTime(0));
+    for (int block = 0; block < 4; ++block)
+    {
+        // on device times these would sit long before frame 0
+        sync.PushAudio(block, AudioTime(block, false));
+    }
+    sync.PushVideo(1, VideoTime(1));
+    Drain(sync, bundles);
+
+    CHECK(bundles.size() == 1);
+    if (bundles.size() == 1)
+    {
+        CHECK(bundles[0].isComplete);
+        CHECK(bundles[0].intervalDuration == FramePeriod);
+        CHECK((bundles[0].audio == std::vector<int>{ 0, 1, 2, 3 }));
+    }
+    CHECK(sync.DroppedAudioCount() == 0);
+
+    // a new session starts on device times again
+    sync.Reset(true);
+    bundles.clear();
+
+    sync.PushVideo(0, VideoTime(0));
+    for (int block = 0; block < 4; ++block)
+    {
+        sync.PushAudio(block, AudioTime(block));
+    }
+    sync.PushVideo(1, VideoTime(1));
+    Drain(sync, bundles);
+
+    CHECK(bundles.size() == 1 && bundles[0].audio.size() == 4);
+}
+
+static void OverflowReleasesIncompleteFrames()
+{
+    AvSynchronizer<int> sync(2);
+    Bundles bundles;
+
+    // no audio arrives, the frames are released once more than two wait
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        sync.PushVideo(frame, VideoTime(frame));
+        Drain(sync, bundles);
+    }
+
+    CHECK(bundles.size() == 1);
+    if (bundles.size() == 1)
+    {
+        CHECK(bundles[0].video == 0);
+        CHECK(!bundles[0].isComplete);
+        CHECK(bundles[0].intervalDuration == FramePeriod);
+        CHECK(bundles[0].audio.empty());
+    }
+
+    sync.PushVideo(3, VideoTime(3));
+    Drain(sync, bundles);
+
+    CHECK(bundles.size() == 2 && bundles[1].video == 1 && !bundles[1].isComplete);
+}
+
+static void FlushSingleFrameWithoutDuration()
+{
+    Bundles bundles;
+
+    // the interval runs to the end of the audio that arrived
+    {
+        AvSynchronizer<int> sync;
+
+        sync.PushVideo(0, VideoTime(0));
+        for (int block = 0; block < 3; ++block)
+        {
+            sync.PushAudio(block, AudioTime(block));
+        }
+        Flush(sync, bundles);
+
+        CHECK(bundles.size() == 1);
+        if (bundles.size() == 1)
+        {
+            CHECK(bundles[0].isComplete);
+            CHECK(bundles[0].intervalDuration == 3 * BlockDuration);
+            CHECK((bundles[0].audio == std::vector<int>{ 0, 1, 2 }));
+        }
+    }
+
+    // without audio it is empty, and incomplete while audio is expected
+    {
+        AvSynchronizer<int> sync;
+
+        bundles.clear();
+        sync.PushVideo(0, VideoTime(0));
+        Flush(sync, bundles);
+
+        CHECK(bundles.size() == 1);
+        if (bundles.size() == 1)
+        {
+            CHECK(!bundles[0].isComplete);
+            CHECK(bundles[0].intervalDuration == 0);
+            CHECK(bundles[0].audio.empty());
+        }
+
+        sync.Reset(false);
+        bundles.clear();
+        sync.PushVideo(1, VideoTime(1));
+        Flush(sync, bundles);
+
+        CHECK(bundles.size() == 1 && bundles[0].isComplete);
+    }
+}
+
+static void WithoutAudioFramesAreReleasedOnceTheirIntervalIsKnown()
+{
+    AvSynchronizer<int> sync;
+    Bundles bundles;
+
+    sync.Reset(false);
+
+    // a known duration is enough
+    sync.PushVideo(0, VideoTime(0, FramePeriod));
+    Drain(sync, bundles);
+
+    CHECK(bundles.size() == 1 && bundles[0].isComplete && bundles[0].intervalDuration == FramePeriod);
+
+    sync.PushVideo(1, VideoTime(1));
+    Drain(sync, bundles);
+    CHECK(bundles.size() == 1);
+
+    sync.PushVideo(2, VideoTime(2));
+    Drain(sync, bundles);
+    CHECK(bundles.size() == 2 && bundles[1].video == 1);
+}
+
+static void DroppedAudioIsCounted()
+{
+    AvSynchronizer<int> sync(4, 3);
+    Bundles bundles;
+
+    // more blocks than fit while no frame is waiting for them
+    for (int block = 0; block < 5; ++block)
+    {
+        sync.PushAudio(block, AudioTime(block));
+    }
+    CHECK(sync.DroppedAudioCount() == 2);
+
+    // blocks that ended before the first frame are dropped when it is released
+    sync.PushVideo(0, VideoTime(4));
+    sync.PushVideo(1, VideoTime(5));
+    sync.PushAudio(20, AudioTime(20));
+    Drain(sync, bundles);
+
+    CHECK(bundles.size() == 1);
+    CHECK(sync.DroppedAudioCount() == 5);
+
+    sync.Reset(true);
+    CHECK(sync.DroppedAudioCount() == 0);
+}
+
+int main()
+{
+    RUN_TEST(InOrderAudioIsPairedWithItsFrame);
+    RUN_TEST(LateAudioIsReordered);
+    RUN_TEST(MissingDeviceTimeFallsBackToSampleTimes);
+    RUN_TEST(OverflowReleasesIncompleteFrames);
+    RUN_TEST(FlushSingleFrameWithoutDuration);
+    RUN_TEST(WithoutAudioFramesAreReleasedOnceTheirIntervalIsKnown);
+    RUN_TEST(DroppedAudioIsCounted);
+
+    return TestResult();
+}
@@ -0,0 +1,269 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// checks the vector paths of BatchMath against its scalar path on random inputs,
+// and both against known results
+
+#include "Media.BatchMath.h"
+
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// the scalar build from ScalarBatchMath.cpp, with the same signatures as BatchMath
+namespace ScalarBatchMath
+{
+    decltype(BatchMath::MultiplyMatrices) MultiplyMatrices;
+    decltype(BatchMath::InvertMatrix) InvertMatrix;
+    decltype(BatchMath::InvertRigidMatrices) InvertRigidMatrices;
+    decltype(BatchMath::TransformPoints) TransformPoints;
+    decltype(BatchMath::TransformCoordinates) TransformCoordinates;
+    decltype(BatchMath::MultiplyQuaternions) MultiplyQuaternions;
+    decltype(BatchMath::RotatePoints) RotatePoints;
+}
+
+static constexpr size_t Count = 257;
+static constexpr float Tolerance = 1e-4f;
+
+static std::mt19937 s_random(42);
+
+static std::vector<float> Random(size_t size, float range = 2.0f)
+{
+    std::uniform_real_distribution<float> value(-range, range);
+
+    std::vector<float> values(size);
+    for (auto& v : values)
+    {
+        v = value(s_random);
+    }
+
+    return values;
+}
+
+static void Normalize(float* q)
+{
+    auto length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        q[i] /= length;
+    }
+}
+
+static std::vector<float> RandomQuaternions(size_t count)
+{
+    auto quaternions = Random(count * 4);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Normalize(&quaternions[i * 4]);
+    }
+
+    return quaternions;
+}
+
+// rotation from a unit quaternion with a translation, the shape of a camera to world transform
+static std::vector<float> RandomRigidMatrices(size_t count)
+{
+    auto quaternions = RandomQuaternions(count);
+    auto translations = Random(count * 3, 10.0f);
+    float origin[3] = {};
+
+    std::vector<float> matrices(count * 16);
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto m = &matrices[i * 16];
+
+        float const axes[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+        for (size_t row = 0; row < 3; ++row)
+        {
+            ScalarBatchMath::RotatePoints(&quaternions[i * 4], &axes[row * 3], &m[row * 4], 1);
+            m[row * 4 + 3] = 0.0f;
+        }
+
+        ScalarBatchMath::TransformPoints(m, origin, &m[12], 1);
+        for (size_t column = 0; column < 3; ++column)
+        {
+            m[12 + column] += translations[i * 3 + column];
+        }
+        m[15] = 1.0f;
+    }
+
+    return matrices;
+}
+
+static void CheckSame(std::vector<float> const& actual, std::vector<float> const& expected, float tolerance = Tolerance)
+{
+    CHECK(actual.size() == expected.size());
+
+    for (size_t i = 0; i < actual.size() && i < expected.size(); ++i)
+    {
+        // relative for the larger values the projection divide can produce
+        CHECK_NEAR(actual[i], expected[i], tolerance * std::fmax(1.0f, std::fabs(expected[i])));
+    }
+}
+
+static void MultiplyMatricesMatchesScalar()
+{
+    auto a = Random(Count * 16);
+    auto b = Random(Count * 16);
+
+    std::vector<float> vector(Count * 16);
+    std::vector<float> scalar(Count * 16);
+
+    BatchMath::MultiplyMatrices(a.data(), b.data(), vector.data(), Count);
+    ScalarBatchMath::MultiplyMatrices(a.data(), b.data(), scalar.data(), Count);
+
+    CheckSame(vector, scalar);
+
+    // in place
+    BatchMath::MultiplyMatrices(a.data(), b.data(), a.data(), Count);
+
+    CheckSame(a, scalar);
+}
+
+static void InvertRigidMatricesMatchesScalar()
+{
+    auto m = RandomRigidMatrices(Count);
+
+    std::vector<float> vector(Count * 16);
+    std::vector<float> scalar(Count * 16);
+
+    BatchMath::InvertRigidMatrices(m.data(), vector.data(), Count);
+    ScalarBatchMath::InvertRigidMatrices(m.data(), scalar.data(), Count);
+
+    CheckSame(vector, scalar);
+
+    // and agrees with the general inverse
+    std::vector<float> general(Count * 16);
+    for (size_t i = 0; i < Count; ++i)
+    {
+        CHECK(BatchMath::InvertMatrix(&m[i * 16], &general[i * 16]));
+    }
+
+    CheckSame(vector, general, 1e-3f);
+
+    // m * inverse(m) is the identity
+    std::vector<float> product(Count * 16);
+    BatchMath::MultiplyMatrices(m.data(), vector.data(), product.data(), Count);
+
+    for (size_t i = 0; i < Count * 16; ++i)
+    {
+        CHECK_NEAR(product[i], (i % 16) % 5 == 0 ? 1.0f : 0.0f, 1e-3f);
+    }
+}
+
+static void InvertMatrixRejectsSingular()
+{
+    float singular[16] = { 1, 2, 3, 4, 2, 4, 6, 8, 0, 0, 1, 0, 0, 0, 0, 1 };
+    float out[16] = {};
+
+    CHECK(!BatchMath::InvertMatrix(singular, out));
+    CHECK(out[0] == 0.0f);
+}
+
+static void TransformPointsMatchesScalar()
+{
+    auto m = Random(16);
+    auto points = Random(Count * 3, 10.0f);
+
+    std::vector<float> vector(Count * 3);
+    std::vector<float> scalar(Count * 3);
+
+    BatchMath::TransformPoints(m.data(), points.data(), vector.data(), Count);
+    ScalarBatchMath::TransformPoints(m.data(), points.data(), scalar.data(), Count);
+
+    CheckSame(vector, scalar);
+
+    // the three float stores must not run past the last point
+    std::vector<float> guarded(Count * 3 + 1, 123.0f);
+    BatchMath::TransformPoints(m.data(), points.data(), guarded.data(), Count);
+
+    CHECK(guarded.back() == 123.0f);
+}
+
+static void TransformCoordinatesMatchesScalar()
+{
+    // a perspective projection keeps w away from zero for points in front of it
+    float projection[16] =
+    {
+        1.5f, 0.0f, 0.0f, 0.0f,
+        0.0f, 2.0f, 0.0f, 0.0f,
+        0.1f, -0.2f, -1.0f, -1.0f,
+        0.0f, 0.0f, -0.1f, 0.0f,
+    };
+
+    auto points = Random(Count * 3, 5.0f);
+    for (size_t i = 0; i < Count; ++i)
+    {
+        points[i * 3 + 2] = -1.0f - std::fabs(points[i * 3 + 2]);
+    }
+
+    std::vector<float> vector(Count * 3);
+    std::vector<float> scalar(Count * 3);
+
+    BatchMath::TransformCoordinates(projection, points.data(), vector.data(), Count);
+    ScalarBatchMath::TransformCoordinates(projection, points.data(), scalar.data(), Count);
+
+    CheckSame(vector, scalar);
+}
+
+static void MultiplyQuaternionsMatchesScalar()
+{
+    auto a = RandomQuaternions(Count);
+    auto b = RandomQuaternions(Count);
+
+    std::vector<float> vector(Count * 4);
+    std::vector<float> scalar(Count * 4);
+
+    BatchMath::MultiplyQuaternions(a.data(), b.data(), vector.data(), Count);
+    ScalarBatchMath::MultiplyQuaternions(a.data(), b.data(), scalar.data(), Count);
+
+    CheckSame(vector, scalar);
+
+    // i * j = k
+    float i[4] = { 1, 0, 0, 0 };
+    float j[4] = { 0, 1, 0, 0 };
+    float k[4] = {};
+
+    BatchMath::MultiplyQuaternions(i, j, k, 1);
+
+    CheckSame({ k, k + 4 }, { 0, 0, 1, 0 });
+}
+
+static void RotatePointsMatchesScalar()
+{
+    auto q = RandomQuaternions(1);
+    auto points = Random(Count * 3, 10.0f);
+
+    std::vector<float> vector(Count * 3);
+    std::vector<float> scalar(Count * 3);
+
+    BatchMath::RotatePoints(q.data(), points.data(), vector.data(), Count);
+    ScalarBatchMath::RotatePoints(q.data(), points.data(), scalar.data(), Count);
+
+    CheckSame(vector, scalar);
+
+    // a quarter turn about z takes x to y
+    auto half = std::sqrt(0.5f);
+    float quarter[4] = { 0, 0, half, half };
+    float x[3] = { 1, 0, 0 };
+    float rotated[3] = {};
+
+    BatchMath::RotatePoints(quarter, x, rotated, 1);
+
+    CheckSame({ rotated, rotated + 3 }, { 0, 1, 0 });
+}
+
+int main()
+{
+    RUN_TEST(MultiplyMatricesMatchesScalar);
+    RUN_TEST(InvertRigidMatricesMatchesScalar);
+    RUN_TEST(InvertMatrixRejectsSingular);
+    RUN_TEST(TransformPointsMatchesScalar);
+    RUN_TEST(TransformCoordinatesMatchesScalar);
+    RUN_TEST(MultiplyQuaternionsMatchesScalar);
+    RUN_TEST(RotatePointsMatchesScalar);
+
+    return TestResult();
+}
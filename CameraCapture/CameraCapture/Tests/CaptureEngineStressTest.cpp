@@ -0,0 +1,317 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Loads the plugin with a D3D11 device standing in for Unity's and hammers
+// StartPreview/StopPreview, and with them the PayloadHandler setter, from the
+// app thread while render events present the frames the payload thread
+// publishes. Fails on a crash, a hang or an unexpected failure callback,
+// skips when there is no camera.
+//
+// usage: CaptureEngineStressTest <path to CameraCapture.dll> [seconds]
+
+#include "pch.h"
+
+#include "Unity/IUnityGraphics.h"
+#include "Unity/IUnityGraphicsD3D11.h"
+
+#include <d3d11.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+static constexpr int SkippedExitCode = 77;
+
+// longest a single StartPreview/StopPreview may block before it counts as a hang
+static constexpr auto MaxCallDuration = 15s;
+
+typedef void(UNITY_INTERFACE_API* PFN_UnityPluginLoad)(IUnityInterfaces*);
+typedef void(UNITY_INTERFACE_API* PFN_UnityPluginUnload)();
+typedef UnityRenderingEvent(UNITY_INTERFACE_API* PFN_GetRenderEventFunc)();
+typedef int32_t(UNITY_INTERFACE_API* PFN_CreateCapture)(StateChangedCallback, void*, INSTANCE_HANDLE*);
+typedef void(UNITY_INTERFACE_API* PFN_ReleaseInstance)(INSTANCE_HANDLE);
+typedef int32_t(UNITY_INTERFACE_API* PFN_SetCallbackDelivery)(INSTANCE_HANDLE, CallbackDelivery);
+typedef int32_t(UNITY_INTERFACE_API* PFN_CaptureStartPreview)(INSTANCE_HANDLE, uint32_t, uint32_t, boolean, boolean);
+typedef int32_t(UNITY_INTERFACE_API* PFN_CaptureStopPreview)(INSTANCE_HANDLE);
+typedef int32_t(UNITY_INTERFACE_API* PFN_CaptureSetTripleBuffering)(INSTANCE_HANDLE, boolean);
+typedef int32_t(UNITY_INTERFACE_API* PFN_CaptureSetFrameDecimation)(INSTANCE_HANDLE, uint32_t, double);
+
+// what the plugin asks of Unity: the renderer type and its device
+static winrt::com_ptr<ID3D11Device> s_device = nullptr;
+
+static UnityGfxRenderer UNITY_INTERFACE_API GetRenderer() { return kUnityGfxRendererD3D11; }
+static void UNITY_INTERFACE_API RegisterDeviceEventCallback(IUnityGraphicsDeviceEventCallback) {}
+static void UNITY_INTERFACE_API UnregisterDeviceEventCallback(IUnityGraphicsDeviceEventCallback) {}
+static int UNITY_INTERFACE_API ReserveEventIDRange(int) { return 0; }
+static ID3D11Device* UNITY_INTERFACE_API GetDevice() { return s_device.get(); }
+
+static IUnityGraphics s_graphics{ GetRenderer, RegisterDeviceEventCallback, UnregisterDeviceEventCallback, ReserveEventIDRange };
+static IUnityGraphicsD3D11 s_graphicsD3D11{ GetDevice, nullptr, nullptr, nullptr, nullptr };
+
+static IUnityInterface* UNITY_INTERFACE_API GetInterface(UnityInterfaceGUID guid)
+{
+    if (guid == UNITY_GET_INTERFACE_GUID(IUnityGraphics))
+    {
+        return &s_graphics;
+    }
+
+    if (guid == UNITY_GET_INTERFACE_GUID(IUnityGraphicsD3D11))
+    {
+        return &s_graphicsD3D11;
+    }
+
+    return nullptr;
+}
+
+static IUnityInterface* UNITY_INTERFACE_API GetInterfaceSplit(unsigned long long guidHigh, unsigned long long guidLow)
+{
+    return GetInterface(UnityInterfaceGUID(guidHigh, guidLow));
+}
+
+static void UNITY_INTERFACE_API RegisterInterface(UnityInterfaceGUID, IUnityInterface*) {}
+static void UNITY_INTERFACE_API RegisterInterfaceSplit(unsigned long long, unsigned long long, IUnityInterface*) {}
+
+static IUnityInterfaces s_interfaces{ GetInterface, RegisterInterface, GetInterfaceSplit, RegisterInterfaceSplit };
+
+struct StressState
+{
+    std::atomic<uint32_t> started{ 0 };
+    std::atomic<uint32_t> stopped{ 0 };
+    std::atomic<uint32_t> videoFrames{ 0 };
+    std::atomic<uint32_t> emptyFrames{ 0 };
+    std::atomic<uint32_t> failures{ 0 };
+    std::atomic<int32_t> lastFailure{ S_OK };
+};
+
+static void __stdcall OnStateChanged(void* callbackObject, CALLBACK_STATE args)
+{
+    auto stress = static_cast<StressState*>(callbackObject);
+
+    if (args.type == CallbackType::Failed)
+    {
+        // a stop that cancels a start is expected to fail it
+        if (args.value.failedState.hresult != HRESULT_FROM_WIN32(ERROR_CANCELLED)
+            &&
+            args.value.failedState.hresult != E_ABORT)
+        {
+            stress->lastFailure = args.value.failedState.hresult;
+            ++stress->failures;
+        }
+
+        return;
+    }
+
+    switch (args.value.captureState.stateType)
+    {
+    case CaptureStateType::PreviewStarted:
+        ++stress->started;
+        break;
+    case CaptureStateType::PreviewStopped:
+        ++stress->stopped;
+        break;
+    case CaptureStateType::PreviewVideoFrame:
+        ++stress->videoFrames;
+        if (args.value.captureState.texturePtr == nullptr)
+        {
+            ++stress->emptyFrames;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+template <typename T>
+static T GetExport(HMODULE plugin, char const* name)
+{
+    auto proc = reinterpret_cast<T>(GetProcAddress(plugin, name));
+    if (proc == nullptr)
+    {
+        printf("missing export %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+
+    return proc;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s <CameraCapture.dll> [seconds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    auto duration = std::chrono::seconds(argc > 2 ? atoi(argv[2]) : 30);
+
+    winrt::init_apartment(winrt::apartment_type::multi_threaded);
+
+    // Unity's device, a hardware adapter when there is one
+    D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
+    if (FAILED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, D3D11_CREATE_DEVICE_BGRA_SUPPORT, &featureLevel, 1, D3D11_SDK_VERSION, s_device.put(), nullptr, nullptr))
+        &&
+        FAILED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, D3D11_CREATE_DEVICE_BGRA_SUPPORT, &featureLevel, 1, D3D11_SDK_VERSION, s_device.put(), nullptr, nullptr)))
+    {
+        printf("no d3d11 device, skipped\n");
+        return SkippedExitCode;
+    }
+
+    auto plugin = LoadLibraryA(argv[1]);
+    if (plugin == nullptr)
+    {
+        printf("could not load %s: %lu\n", argv[1], GetLastError());
+        return EXIT_FAILURE;
+    }
+
+    auto unityPluginLoad = GetExport<PFN_UnityPluginLoad>(plugin, "UnityPluginLoad");
+    auto unityPluginUnload = GetExport<PFN_UnityPluginUnload>(plugin, "UnityPluginUnload");
+    auto getRenderEventFunc = GetExport<PFN_GetRenderEventFunc>(plugin, "GetRenderEventFunc");
+    auto createCapture = GetExport<PFN_CreateCapture>(plugin, "CreateCapture");
+    auto releaseInstance = GetExport<PFN_ReleaseInstance>(plugin, "ReleaseInstance");
+    auto setCallbackDelivery = GetExport<PFN_SetCallbackDelivery>(plugin, "SetCallbackDelivery");
+    auto startPreview = GetExport<PFN_CaptureStartPreview>(plugin, "CaptureStartPreview");
+    auto stopPreview = GetExport<PFN_CaptureStopPreview>(plugin, "CaptureStopPreview");
+    auto setTripleBuffering = GetExport<PFN_CaptureSetTripleBuffering>(plugin, "CaptureSetTripleBuffering");
+    auto setFrameDecimation = GetExport<PFN_CaptureSetFrameDecimation>(plugin, "CaptureSetFrameDecimation");
+
+    unityPluginLoad(&s_interfaces);
+
+    StressState stress;
+
+    INSTANCE_HANDLE id = INSTANCE_HANDLE_INVALID;
+    if (FAILED(createCapture(OnStateChanged, &stress, &id)))
+    {
+        printf("CreateCapture failed\n");
+        return EXIT_FAILURE;
+    }
+
+    setCallbackDelivery(id, CallbackDelivery::RenderEvent);
+    setTripleBuffering(id, true);
+
+    // the first start tells whether there is a camera to stress, it fails asynchronously without one
+    auto hr = startPreview(id, 1280, 720, false, false);
+    for (auto waited = 0ms; SUCCEEDED(hr) && stress.started == 0 && stress.failures == 0 && waited < MaxCallDuration; waited += 10ms)
+    {
+        getRenderEventFunc()(static_cast<int>(MAKELONG(static_cast<WORD>(id), 0)));
+
+        std::this_thread::sleep_for(10ms);
+    }
+
+    if (FAILED(hr) || stress.started == 0)
+    {
+        printf("no capture device, skipped\n");
+        releaseInstance(id);
+        unityPluginUnload();
+        return SkippedExitCode;
+    }
+
+    // Unity's render thread, the only one using the immediate context of its device
+    std::atomic<bool> isRunning = true;
+    std::thread renderThread([&]()
+    {
+        auto onRenderEvent = getRenderEventFunc();
+
+        uint16_t frameId = 0;
+        while (isRunning)
+        {
+            onRenderEvent(static_cast<int>(MAKELONG(static_cast<WORD>(id), ++frameId)));
+
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+
+    // the app thread, each call has to come back in time or the test has hung
+    std::atomic<int64_t> callStarted = 0;
+    std::thread watchdog([&]()
+    {
+        while (isRunning)
+        {
+            auto started = callStarted.load();
+            if (started != 0 && std::chrono::steady_clock::now().time_since_epoch().count() - started > std::chrono::duration_cast<std::chrono::steady_clock::duration>(MaxCallDuration).count())
+            {
+                printf("StartPreview/StopPreview did not return, hung\n");
+                fflush(stdout);
+                TerminateProcess(GetCurrentProcess(), EXIT_FAILURE);
+            }
+
+            std::this_thread::sleep_for(100ms);
+        }
+    });
+
+    auto timedCall = [&](auto&& call)
+    {
+        callStarted = std::chrono::steady_clock::now().time_since_epoch().count();
+        auto hr = call();
+        callStarted = 0;
+
+        return hr;
+    };
+
+    std::mt19937 random(GetTickCount());
+    std::uniform_int_distribution<int> runTime(0, 300);
+
+    uint32_t cycles = 0;
+    uint32_t rejected = 0;
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end)
+    {
+        // stop while starting, right after the first frame and while streaming
+        std::this_thread::sleep_for(std::chrono::milliseconds(runTime(random)));
+
+        if (FAILED(timedCall([&]() { return stopPreview(id); })))
+        {
+            ++rejected;
+        }
+
+        // payloads of the stopped stream can still be in flight against the new handler
+        setFrameDecimation(id, cycles % 3, 0.0);
+        setTripleBuffering(id, cycles % 4 != 0);
+
+        if (FAILED(timedCall([&]() { return startPreview(id, 1280, 720, cycles % 2 == 0, false); })))
+        {
+            ++rejected;
+        }
+
+        ++cycles;
+    }
+
+    timedCall([&]() { return stopPreview(id); });
+
+    // let the last stop unwind before the instance goes away
+    std::this_thread::sleep_for(1s);
+
+    isRunning = false;
+    renderThread.join();
+    watchdog.join();
+
+    releaseInstance(id);
+    unityPluginUnload();
+
+    printf("cycles %u, rejected calls %u, started %u, stopped %u, video frames %u, failures %u\n",
+        cycles, rejected, stress.started.load(), stress.stopped.load(), stress.videoFrames.load(), stress.failures.load());
+
+    if (stress.failures != 0)
+    {
+        printf("unexpected failure 0x%08x\n", static_cast<uint32_t>(stress.lastFailure.load()));
+        return EXIT_FAILURE;
+    }
+
+    if (stress.emptyFrames != 0)
+    {
+        printf("%u video frames without a texture\n", stress.emptyFrames.load());
+        return EXIT_FAILURE;
+    }
+
+    if (stress.videoFrames == 0)
+    {
+        printf("no video frame was presented\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
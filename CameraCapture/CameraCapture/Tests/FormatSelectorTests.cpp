@@ -0,0 +1,164 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// scores recorded device capability tables against typical requests
+
+#include "Media.FormatSelector.h"
+
+#include "TestHelpers.h"
+
+#include <vector>
+
+enum SubType : uint32_t
+{
+    NV12 = 1,
+    YUY2 = 2,
+    MJPG = 3,
+};
+
+static FormatMode Mode(uint32_t width, uint32_t height, double frameRate, uint32_t subTypeId = NV12)
+{
+    return { width, height, FrameRate::FromDouble(frameRate), subTypeId };
+}
+
+static FormatRequest Request(uint32_t width, uint32_t height, double frameRate, uint32_t preferredSubTypeId = NV12)
+{
+    return { width, height, FrameRate::FromDouble(frameRate), preferredSubTypeId };
+}
+
+// HoloLens 2 photo/video camera, video record profiles
+static std::vector<FormatMode> const HoloLens2 =
+{
+    Mode(1920, 1080, 30),
+    Mode(1920, 1080, 15),
+    Mode(1504, 846, 30),
+    Mode(1280, 720, 30),
+    Mode(1280, 720, 15),
+    Mode(960, 540, 30),
+    Mode(640, 360, 30),
+    Mode(424, 240, 15),
+    Mode(2272, 1278, 30),
+    Mode(3904, 2196, 30),
+};
+
+// HoloLens (1st gen) photo/video camera
+static std::vector<FormatMode> const HoloLens1 =
+{
+    Mode(1280, 720, 30),
+    Mode(1408, 792, 30),
+    Mode(1344, 756, 30),
+    Mode(896, 504, 30),
+    Mode(2048, 1152, 30),
+};
+
+// USB webcam, NTSC rates, uncompressed modes limited by USB 2 bandwidth
+static std::vector<FormatMode> const Webcam =
+{
+    Mode(640, 480, 29.97, YUY2),
+    Mode(640, 480, 29.97, MJPG),
+    Mode(1280, 720, 9.99, YUY2),
+    Mode(1280, 720, 29.97, MJPG),
+    Mode(1920, 1080, 29.97, MJPG),
+    Mode(320, 240, 29.97, YUY2),
+};
+
+static size_t Select(std::vector<FormatMode> const& modes, FormatRequest const& request, double* pScore = nullptr)
+{
+    return FormatSelector::SelectBest(modes, request, [](FormatMode const& mode) -> FormatMode const& { return mode; }, pScore);
+}
+
+static void NtscRatesAreExactRatios()
+{
+    auto ntsc30 = FrameRate::FromDouble(29.97);
+    CHECK(ntsc30.numerator == 30000 && ntsc30.denominator == 1001);
+
+    auto ntsc60 = FrameRate::FromDouble(59.94);
+    CHECK(ntsc60.numerator == 60000 && ntsc60.denominator == 1001);
+
+    auto ntsc15 = FrameRate::FromDouble(14.985);
+    CHECK(ntsc15.numerator == 15000 && ntsc15.denominator == 1001);
+
+    // whole rates stay whole
+    auto whole = FrameRate::FromDouble(30.0);
+    CHECK(whole.numerator == 30000 && whole.denominator == 1000);
+
+    auto none = FrameRate::FromDouble(0.0);
+    CHECK(none.numerator == 0 && none.Value() == 0.0);
+
+    // 29.97 serves a 30 fps request without a penalty
+    CHECK(FormatSelector::Score(Mode(1280, 720, 29.97), Request(1280, 720, 30)) == 0.0);
+}
+
+static void ExactModeIsAPerfectScore()
+{
+    double score = -1.0;
+
+    CHECK(Select(HoloLens2, Request(1280, 720, 30), &score) == 3);
+    CHECK(score == 0.0);
+
+    CHECK(Select(Webcam, Request(1280, 720, 30, MJPG), &score) == 3);
+    CHECK(score == 0.0);
+}
+
+// scaling a mode up costs more than cropping a larger one to another aspect ratio
+static void UpscaleCostsMoreThanAspectMismatch()
+{
+    // 4:3 on a 16:9 device, the only modes at least 1280x960 are 1920x1080 and up
+    auto index = Select(HoloLens1, Request(1280, 960, 30));
+    CHECK(index == 4);
+
+    auto upscale = FormatSelector::Score(Mode(1280, 720, 30), Request(1280, 960, 30));
+    auto crop = FormatSelector::Score(Mode(1920, 1080, 30), Request(1280, 960, 30));
+    CHECK(crop < upscale);
+
+    // larger than requested, the smallest mode that covers it wins
+    CHECK(Select(HoloLens2, Request(1600, 900, 30)) == 0);
+}
+
+static void PreferredSubTypeWins()
+{
+    CHECK(Webcam[Select(Webcam, Request(640, 480, 30, MJPG))].subTypeId == MJPG);
+    CHECK(Webcam[Select(Webcam, Request(640, 480, 30, YUY2))].subTypeId == YUY2);
+
+    // but not at the cost of the frame rate, YUY2 720p only reaches 10 fps
+    auto index = Select(Webcam, Request(1280, 720, 30, YUY2));
+    CHECK(index == 3);
+    CHECK(Webcam[index].subTypeId == MJPG);
+}
+
+static void EqualScoresGoToTheLeastBandwidth()
+{
+    // no rate requested, 720p at 30 and 15 fps score the same
+    auto request = Request(1280, 720, 0);
+
+    CHECK(FormatSelector::Score(HoloLens2[3], request) == FormatSelector::Score(HoloLens2[4], request));
+    CHECK(Select(HoloLens2, request) == 4);
+
+    // listed the other way around
+    std::vector<FormatMode> reversed = { HoloLens2[4], HoloLens2[3] };
+    CHECK(Select(reversed, request) == 0);
+}
+
+static void EmptyTableHasNoMatch()
+{
+    double score = 0.0;
+
+    CHECK(Select({}, Request(1280, 720, 30), &score) == FormatSelector::NoMatch);
+    CHECK(score == std::numeric_limits<double>::max());
+
+    // a zero sized mode or request never matches
+    CHECK(FormatSelector::Score(Mode(0, 0, 30), Request(1280, 720, 30)) == std::numeric_limits<double>::max());
+    CHECK(FormatSelector::Score(Mode(1280, 720, 30), Request(0, 0, 30)) == std::numeric_limits<double>::max());
+}
+
+int main()
+{
+    RUN_TEST(NtscRatesAreExactRatios);
+    RUN_TEST(ExactModeIsAPerfectScore);
+    RUN_TEST(UpscaleCostsMoreThanAspectMismatch);
+    RUN_TEST(PreferredSubTypeWins);
+    RUN_TEST(EqualScoresGoToTheLeastBandwidth);
+    RUN_TEST(EmptyTableHasNoMatch);
+
+    return TestResult();
+}
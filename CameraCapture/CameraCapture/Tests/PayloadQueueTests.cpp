@@ -0,0 +1,103 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// lane ordering of the payload handler's queue, entries stood in for by their names
+
+#include "Media.PayloadQueue.h"
+
+#include "TestHelpers.h"
+
+#include <string>
+#include <vector>
+
+using Queue = PayloadQueue<std::string>;
+
+static std::vector<std::string> PopAll(Queue& queue)
+{
+    std::vector<std::string> entries;
+
+    std::string entry;
+    while (queue.Pop(entry))
+    {
+        entries.push_back(entry);
+    }
+
+    return entries;
+}
+
+static void DataAndControlKeepTheirOrder()
+{
+    Queue queue;
+
+    queue.Push("frame 0", Queue::Lane::Data);
+    queue.Push("format", Queue::Lane::Control);
+    queue.Push("frame 1", Queue::Lane::Data);
+    queue.Push("end of stream", Queue::Lane::Control);
+
+    CHECK(queue.DataCount() == 2);
+    CHECK(queue.ControlCount() == 2);
+
+    CHECK((PopAll(queue) == std::vector<std::string>{ "frame 0", "format", "frame 1", "end of stream" }));
+
+    CHECK(queue.DataCount() == 0);
+    CHECK(queue.ControlCount() == 0);
+}
+
+static void FlushJumpsTheQueue()
+{
+    Queue queue;
+
+    queue.Push("frame 0", Queue::Lane::Data);
+    queue.Push("marker", Queue::Lane::Control);
+    queue.Push("flush", Queue::Lane::Priority);
+    queue.Push("flush 2", Queue::Lane::Priority);
+
+    CHECK(queue.ControlCount() == 3);
+
+    CHECK((PopAll(queue) == std::vector<std::string>{ "flush", "flush 2", "frame 0", "marker" }));
+}
+
+static void DropDataKeepsControlEntries()
+{
+    Queue queue;
+
+    queue.Push("frame 0", Queue::Lane::Data);
+    queue.Push("format", Queue::Lane::Control);
+    queue.Push("frame 1", Queue::Lane::Data);
+    queue.Push("frame 2", Queue::Lane::Data);
+    queue.Push("marker", Queue::Lane::Control);
+
+    CHECK(queue.DropData() == 3);
+    CHECK(queue.DataCount() == 0);
+
+    // data queued after the drop is not affected
+    queue.Push("frame 3", Queue::Lane::Data);
+
+    CHECK((PopAll(queue) == std::vector<std::string>{ "format", "marker", "frame 3" }));
+}
+
+static void ClearEmptiesEveryLane()
+{
+    Queue queue;
+
+    queue.Push("frame 0", Queue::Lane::Data);
+    queue.Push("marker", Queue::Lane::Control);
+    queue.Push("flush", Queue::Lane::Priority);
+
+    queue.Clear();
+
+    std::string entry;
+    CHECK(!queue.Pop(entry));
+    CHECK(queue.DataCount() == 0);
+    CHECK(queue.ControlCount() == 0);
+}
+
+int main()
+{
+    RUN_TEST(DataAndControlKeepTheirOrder);
+    RUN_TEST(FlushJumpsTheQueue);
+    RUN_TEST(DropDataKeepsControlEntries);
+    RUN_TEST(ClearEmptiesEveryLane);
+
+    return TestResult();
+}
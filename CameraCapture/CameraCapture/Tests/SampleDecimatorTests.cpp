@@ -0,0 +1,216 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// decimates synthetic 30 fps streams (100ns units)
+
+#include "Media.SampleDecimator.h"
+
+#include "TestHelpers.h"
+
+#include <vector>
+
+static constexpr int64_t Period = 333333;
+
+static std::vector<int64_t> Delivered(SampleDecimator& decimator, std::vector<int64_t> const& sampleTimes)
+{
+    std::vector<int64_t> delivered;
+    for (auto sampleTime : sampleTimes)
+    {
+        if (decimator.ShouldDeliver(sampleTime))
+        {
+            delivered.push_back(sampleTime);
+        }
+    }
+
+    return delivered;
+}
+
+static std::vector<int64_t> Frames(int64_t count, int64_t jitter = 0)
+{
+    std::vector<int64_t> sampleTimes;
+    for (int64_t frame = 0; frame < count; ++frame)
+    {
+        // alternately early and late
+        sampleTimes.push_back(frame * Period + ((frame % 2) != 0 ? -jitter : jitter));
+    }
+
+    return sampleTimes;
+}
+
+static void IntervalKeepsEveryNthSample()
+{
+    SampleDecimator decimator;
+    decimator.FrameInterval(3);
+
+    CHECK(decimator.IsEnabled());
+    CHECK((Delivered(decimator, Frames(9)) == std::vector<int64_t>{ 0, 3 * Period, 6 * Period }));
+
+    // 0 and 1 deliver everything
+    decimator.FrameInterval(1);
+    CHECK(!decimator.IsEnabled());
+    CHECK(Delivered(decimator, Frames(9)).size() == 9);
+
+    decimator.FrameInterval(0);
+    CHECK(decimator.FrameInterval() == 1);
+    CHECK(Delivered(decimator, Frames(9)).size() == 9);
+}
+
+static void TargetRateHalvesTheStream()
+{
+    SampleDecimator decimator;
+    decimator.TargetFrameRate(15.0);
+
+    auto delivered = Delivered(decimator, Frames(300));
+
+    CHECK(delivered.size() == 150);
+    for (size_t i = 1; i < delivered.size(); ++i)
+    {
+        CHECK(delivered[i] - delivered[i - 1] == 2 * Period);
+    }
+}
+
+// a sample up to half a source period ahead of its deadline still counts for it
+static void TargetRateToleratesHalfAPeriodOfJitter()
+{
+    SampleDecimator decimator;
+    decimator.TargetFrameRate(15.0);
+
+    auto delivered = Delivered(decimator, Frames(300, Period / 4));
+
+    CHECK(delivered.size() == 150);
+
+    // just early for the deadline is taken, not skipped to the next frame
+    decimator.Reset();
+    CHECK(decimator.ShouldDeliver(0));
+    CHECK(!decimator.ShouldDeliver(Period));
+    CHECK(decimator.ShouldDeliver(2 * Period - 1000));
+}
+
+static void TargetRateDoesNotDrift()
+{
+    SampleDecimator decimator;
+    decimator.TargetFrameRate(24.0);
+
+    // ten seconds of 30 fps
+    auto delivered = Delivered(decimator, Frames(300));
+
+    CHECK_NEAR(static_cast<double>(delivered.size()), 240.0, 1.0);
+
+    // faster than the source delivers every sample
+    decimator.TargetFrameRate(60.0);
+    CHECK(Delivered(decimator, Frames(30)).size() == 30);
+}
+
+static void RestartedStreamStartsOver()
+{
+    SampleDecimator decimator;
+    decimator.FrameInterval(2);
+
+    CHECK(decimator.ShouldDeliver(0));
+    CHECK(!decimator.ShouldDeliver(Period));
+
+    // timestamps went backwards, the next sample is the first of a new stream
+    CHECK(decimator.ShouldDeliver(0));
+    CHECK(!decimator.ShouldDeliver(Period));
+}
+
+static void TakeOnlyPassesAdmittedSamples()
+{
+    SubscriberDecimation everyOther(2, 0.0);
+    SubscriberDecimation everyThird(3, 0.0);
+
+    // the handler queues a sample if any subscriber admits it
+    std::vector<int64_t> queued;
+    for (auto sampleTime : Frames(12))
+    {
+        auto admittedByOther = everyOther.Admit(sampleTime);
+        auto admittedByThird = everyThird.Admit(sampleTime);
+        if (admittedByOther || admittedByThird)
+        {
+            queued.push_back(sampleTime);
+        }
+    }
+
+    CHECK(queued.size() == 8);
+
+    // each subscriber gets exactly the samples it admitted
+    std::vector<int64_t> other;
+    std::vector<int64_t> third;
+    for (auto sampleTime : queued)
+    {
+        if (everyOther.Take(sampleTime))
+        {
+            other.push_back(sampleTime);
+        }
+        if (everyThird.Take(sampleTime))
+        {
+            third.push_back(sampleTime);
+        }
+    }
+
+    CHECK((other == std::vector<int64_t>{ 0, 2 * Period, 4 * Period, 6 * Period, 8 * Period, 10 * Period }));
+    CHECK((third == std::vector<int64_t>{ 0, 3 * Period, 6 * Period, 9 * Period }));
+
+    // never twice
+    CHECK(!everyOther.Take(0));
+}
+
+static void TakeMatchesOutOfOrder()
+{
+    SubscriberDecimation decimation(2, 0.0);
+
+    CHECK(decimation.Admit(0));
+    CHECK(!decimation.Admit(Period));
+    CHECK(decimation.Admit(2 * Period));
+
+    CHECK(decimation.Take(2 * Period));
+    CHECK(!decimation.Take(Period));
+    CHECK(decimation.Take(0));
+}
+
+static void AdmittedSamplesAgeOut()
+{
+    // everything is admitted, 1000 fps is faster than the source
+    SubscriberDecimation decimation(1, 1000.0);
+
+    auto sampleTimes = Frames(SubscriberDecimation::MaxAdmitted + 1);
+    for (auto sampleTime : sampleTimes)
+    {
+        CHECK(decimation.Admit(sampleTime));
+    }
+
+    // the first was flushed before it reached the subscriber
+    CHECK(!decimation.Take(sampleTimes.front()));
+    CHECK(decimation.Take(sampleTimes.back()));
+
+    // a new configuration forgets what was admitted
+    CHECK(decimation.Admit(sampleTimes.back() + Period));
+    decimation.Configure(2, 0.0);
+    CHECK(!decimation.Take(sampleTimes.back() + Period));
+}
+
+static void DisabledDecimationPassesEverything()
+{
+    SubscriberDecimation decimation(0, 0.0);
+
+    CHECK(!decimation.IsEnabled());
+    CHECK(decimation.Admit(0));
+    CHECK(decimation.Take(0));
+    CHECK(decimation.Take(0));
+    CHECK(decimation.Take(Period));
+}
+
+int main()
+{
+    RUN_TEST(IntervalKeepsEveryNthSample);
+    RUN_TEST(TargetRateHalvesTheStream);
+    RUN_TEST(TargetRateToleratesHalfAPeriodOfJitter);
+    RUN_TEST(TargetRateDoesNotDrift);
+    RUN_TEST(RestartedStreamStartsOver);
+    RUN_TEST(TakeOnlyPassesAdmittedSamples);
+    RUN_TEST(TakeMatchesOutOfOrder);
+    RUN_TEST(AdmittedSamplesAgeOut);
+    RUN_TEST(DisabledDecimationPassesEverything);
+
+    return TestResult();
+}
@@ -0,0 +1,10 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// Media.BatchMath.cpp built a second time with only its scalar path, as the
+// ScalarBatchMath namespace, for BatchMathTests to compare the vector paths against
+
+#define BATCHMATH_NO_SIMD
+#define BatchMath ScalarBatchMath
+
+#include "Media.BatchMath.cpp"
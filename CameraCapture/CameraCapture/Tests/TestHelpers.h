@@ -0,0 +1,26 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// minimal checks for the portable tests, a failed check is reported and the test
+// keeps going so one run shows every failure
+static int s_failedChecks = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { ++s_failedChecks; printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); } } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { auto a_ = (actual); auto e_ = (expected); auto d_ = a_ > e_ ? a_ - e_ : e_ - a_; \
+        if (d_ > (tolerance)) { ++s_failedChecks; printf("%s(%d): CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #actual, #expected, static_cast<double>(a_), static_cast<double>(e_)); } } while (0)
+
+#define RUN_TEST(test) \
+    do { auto failed_ = s_failedChecks; test(); printf("%s %s\n", s_failedChecks == failed_ ? "passed" : "FAILED", #test); } while (0)
+
+inline int TestResult()
+{
+    return s_failedChecks == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
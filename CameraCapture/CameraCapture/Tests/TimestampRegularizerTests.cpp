@@ -0,0 +1,136 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license information.
+
+// replays synthetic 30 fps timestamp traces (100ns units) through the regularizer
+
+#include "Media.TimestampRegularizer.h"
+
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <random>
+
+static constexpr double Period = 10000000.0 / 30.0;
+
+static int64_t FrameTime(int64_t frame)
+{
+    return std::llround(frame * Period);
+}
+
+// a regularizer that has locked onto 30 fps, the last frame fed is frame - 1
+static TimestampRegularizer Locked(int64_t frames)
+{
+    TimestampRegularizer regularizer;
+    for (int64_t frame = 0; frame < frames; ++frame)
+    {
+        regularizer.Process(FrameTime(frame));
+    }
+
+    return regularizer;
+}
+
+static void JitterIsMovedOntoTheGrid()
+{
+    TimestampRegularizer regularizer;
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> jitter(-0.15 * Period, 0.15 * Period);
+
+    int64_t last = -1;
+    for (int64_t frame = 0; frame < 300; ++frame)
+    {
+        auto result = regularizer.Process(FrameTime(frame) + std::llround(jitter(random)));
+
+        CHECK(result.timestamp > last);
+        CHECK(!result.isDiscontinuity || frame == 0);
+
+        if (frame >= 64)
+        {
+            CHECK_NEAR(result.timestamp, FrameTime(frame), 0.1 * Period);
+        }
+
+        last = result.timestamp;
+    }
+
+    CHECK_NEAR(regularizer.Period(), Period, 0.01 * Period);
+}
+
+static void SkippedFramesAreCounted()
+{
+    auto regularizer = Locked(40);
+
+    auto result = regularizer.Process(FrameTime(43));
+
+    CHECK(result.skippedFrames == 3);
+    CHECK(!result.isDiscontinuity);
+    CHECK_NEAR(result.timestamp, FrameTime(43), 2);
+}
+
+// a pause longer than maxSkippedFrames keeps the measured time of the first frame after it
+static void GapRestartsAtTheMeasuredTime()
+{
+    auto regularizer = Locked(40);
+
+    auto resumed = FrameTime(39) + 20000000 + FrameTime(1);
+
+    auto result = regularizer.Process(resumed);
+
+    CHECK(result.isDiscontinuity);
+    CHECK(!result.isCorrected);
+    CHECK(result.timestamp == resumed);
+
+    for (int64_t frame = 1; frame < 10; ++frame)
+    {
+        auto next = regularizer.Process(resumed + FrameTime(frame));
+
+        CHECK(!next.isDiscontinuity);
+        CHECK_NEAR(next.timestamp, resumed + FrameTime(frame), 2);
+    }
+}
+
+// a single glitch behind the grid is moved forward so time does not go backwards
+static void BackwardGlitchIsSnappedForward()
+{
+    auto regularizer = Locked(40);
+
+    auto result = regularizer.Process(FrameTime(40) - std::llround(0.6 * Period));
+
+    CHECK(!result.isDiscontinuity);
+    CHECK(result.isCorrected);
+    CHECK_NEAR(result.timestamp, FrameTime(40), 2);
+
+    auto next = regularizer.Process(FrameTime(41));
+
+    CHECK(!next.isDiscontinuity);
+    CHECK_NEAR(next.timestamp, FrameTime(41), 2);
+}
+
+// a single glitch ahead of the grid keeps its measured time
+static void ForwardGlitchKeepsItsTime()
+{
+    auto regularizer = Locked(40);
+
+    auto glitch = FrameTime(40) + std::llround(0.4 * Period);
+
+    auto result = regularizer.Process(glitch);
+
+    CHECK(!result.isDiscontinuity);
+    CHECK(result.timestamp == glitch);
+
+    auto next = regularizer.Process(FrameTime(41) + std::llround(0.45 * Period));
+
+    // a second one in a row is a discontinuity
+    CHECK(next.isDiscontinuity);
+    CHECK(next.timestamp > glitch);
+}
+
+int main()
+{
+    RUN_TEST(JitterIsMovedOntoTheGrid);
+    RUN_TEST(SkippedFramesAreCounted);
+    RUN_TEST(GapRestartsAtTheMeasuredTime);
+    RUN_TEST(BackwardGlitchIsSnappedForward);
+    RUN_TEST(ForwardGlitchKeepsItsTime);
+
+    return TestResult();
+}
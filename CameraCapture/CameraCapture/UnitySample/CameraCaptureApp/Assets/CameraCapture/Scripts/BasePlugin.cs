@@ -33,6 +33,20 @@ namespace CameraCapture
             PhotoFrame,
         };
 
+        // mirrors FrameFlags
+        [Flags]
+        internal enum FrameFlags : UInt32
+        {
+            None = 0,
+            Redundant = 0x1
+        }
+
+        internal enum CallbackDelivery : Int32
+        {
+            Immediate = 0,
+            RenderEvent,
+        };
+
         [StructLayout(LayoutKind.Sequential)]
         internal struct FailedState
         {
@@ -55,6 +69,9 @@ namespace CameraCapture
             public IntPtr imgTexture;
             public SpatialTranformHelper.Matrix4x4 cameraWorld;
             public SpatialTranformHelper.Matrix4x4 cameraProjection;
+            public Int64 timestamp;
+            public Int64 deviceTimestamp;
+            public FrameFlags flags;
 
             public override string ToString()
             {
@@ -86,9 +103,15 @@ namespace CameraCapture
         [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "GetRenderEventFunc")]
         internal static extern IntPtr GetRenderEventFunc();
 
+        [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "Prewarm")]
+        internal static extern void Prewarm();
+
         [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "ReleaseInstance")]
         internal static extern void ReleaseInstance(Int32 instanceId);
 
+        [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "SetCallbackDelivery")]
+        internal static extern Int32 SetCallbackDelivery(Int32 instanceId, CallbackDelivery delivery);
+
         [DllImport(ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CreateCapture")]
         internal static extern Int32 CreateCapture([MarshalAs(UnmanagedType.FunctionPtr)]Wrapper.StateChangedCallback callback, IntPtr objectPtr, out Int32 instanceId);
     }
@@ -163,6 +186,8 @@ namespace CameraCapture
         private IEnumerator coroutine = null;
         private IEnumerator callbacksCoroutine = null;
         public bool oneCallbackPerFrame = true;
+        // plugin holds state changes until the next render event, keeping only the latest video frame
+        public bool deliverCallbacksOnRenderEvent = false;
         private readonly object eventLock = new object();
         private readonly List<Action> callbacks = new List<Action>();
         private readonly List<Action> callbacksToProcess = new List<Action>();
@@ -173,6 +198,9 @@ namespace CameraCapture
             thisObject = GCHandle.Alloc(this, GCHandleType.Normal);
 
             renderFuncPtr = Wrapper.GetRenderEventFunc();
+
+            // no-op if the plugin already prewarmed on load
+            Wrapper.Prewarm();
         }
 
         protected virtual void OnDestroy()
@@ -234,6 +262,9 @@ namespace CameraCapture
 
                 if (instanceId != Wrapper.InvalidHandle && renderFuncPtr != IntPtr.Zero)
                 {
+                    // the plugin presents at most one new video frame per frame id
+                    currentFrameIndex = unchecked((UInt16)Time.frameCount);
+
                     // hi - lastFrameIndex / low - instanceId
                     int packedValue = ((0xffff & currentFrameIndex) << 16) | (0xffff & instanceId);
 
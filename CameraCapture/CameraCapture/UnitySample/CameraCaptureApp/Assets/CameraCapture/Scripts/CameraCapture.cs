@@ -13,12 +13,96 @@ using UnityEngine.Windows.Speech;
 
 namespace CameraCapture
 {
+    // duration of each StartPreview phase in microseconds, mirrors STARTUP_TIMINGS
+    [StructLayout(LayoutKind.Sequential, Pack = 4)]
+    public struct StartupTimings
+    {
+        public UInt32 DeviceDiscovery;
+        public UInt32 FormatSelection;
+        public UInt32 Initialize;
+        public UInt32 StreamProperties;
+        public UInt32 Effects;
+        public UInt32 StartStream;
+        public UInt32 FirstFrame;
+        public UInt32 Total;
+        [MarshalAs(UnmanagedType.Bool)]
+        public Boolean IsWarmStart;
+    }
+
+    // duration of the last StopPreview in microseconds, mirrors TEARDOWN_TIMINGS
+    [StructLayout(LayoutKind.Sequential, Pack = 4)]
+    public struct TeardownTimings
+    {
+        public UInt32 Cancel;
+        public UInt32 StopStream;
+        public UInt32 Release;
+        public UInt32 Total;
+        [MarshalAs(UnmanagedType.Bool)]
+        public Boolean WasCancelled;
+    }
+
+    // where a video frame's latency is measured, mirrors LatencyStage
+    public enum LatencyStage : Int32
+    {
+        SinkArrival = 0,
+        Dequeue,
+        CopyDone,
+        Callback,
+        RenderEvent
+    }
+
+    // latency from capture in microseconds, mirrors LATENCY_STATS
+    [StructLayout(LayoutKind.Sequential, Pack = 4)]
+    public struct LatencyStats
+    {
+        public UInt64 Count;
+        public UInt32 Minimum;
+        public UInt32 Maximum;
+        public UInt32 Mean;
+        public UInt32 P50;
+        public UInt32 P90;
+        public UInt32 P99;
+    }
+
+    // mirrors CAMERA_CALIBRATION, read in place with CameraCapture.TryGetCameraCalibration
+    [StructLayout(LayoutKind.Sequential, Pack = 4)]
+    public struct CameraCalibration
+    {
+        public const UInt32 CurrentVersion = 1;
+
+        public UInt32 Version;
+        public UInt32 Size;
+        public Int32 ChangeCount;
+        public UInt32 Width;
+        public UInt32 Height;
+        public Vector2 FocalLength;
+        public Vector2 PrincipalPoint;
+        public Vector3 RadialDistortion;
+        public Vector2 TangentialDistortion;
+        public Vector3 ExtrinsicPosition;
+        public Quaternion ExtrinsicOrientation;
+        public Guid CalibrationId;
+        public UInt32 Reserved;
+        public Int64 SampleTime;
+        public Int64 DeviceTimestamp;
+    }
+
+    // how a camera pose is extrapolated, mirrors PosePrediction
+    public enum PosePrediction : Int32
+    {
+        ConstantVelocity = 0,
+        ConstantAcceleration
+    }
+
     internal class CameraCapture : BasePlugin<CameraCapture>
     {
         public Int32 Width = 1280;
         public Int32 Height = 720;
         public Boolean EnableAudio = false;
         public Boolean EnableMrc = false;
+        public Boolean TripleBufferVideo = false;
+        public Boolean KeepWarm = false;
+        public UInt32 KeepWarmIdleTimeoutMs = 30000;
         public SpatialCameraTracker CameraTracker = null;
 
         public Renderer VideoRenderer = null;
@@ -28,10 +112,15 @@ namespace CameraCapture
         private Texture2D photoTexture = null;
 
         private IntPtr spatialCoordinateSystemPtr = IntPtr.Zero;
+        private IntPtr calibrationPtr = IntPtr.Zero;
 
         TaskCompletionSource<Wrapper.CaptureState> startPreviewCompletionSource = null;
         TaskCompletionSource<Wrapper.CaptureState> stopCompletionSource = null;
         TaskCompletionSource<Wrapper.CaptureState> photoCompletionSource = null;
+        TaskCompletionSource<List<Texture2D>> burstCompletionSource = null;
+        List<Texture2D> burstPhotos = null;
+        int burstCount = 0;
+        bool burstFlipImage = false;
 
         private const string takePhoto = "take photo";
         private const string startPreview = "start preview";
@@ -166,7 +255,14 @@ namespace CameraCapture
                         OnPreviewFrameChanged(args.CaptureState);
                         break;
                     case Wrapper.CaptureStateType.PhotoFrame:
-                        photoCompletionSource?.TrySetResult(args.CaptureState);
+                        if (burstCompletionSource != null)
+                        {
+                            OnBurstPhoto(args.CaptureState);
+                        }
+                        else
+                        {
+                            photoCompletionSource?.TrySetResult(args.CaptureState);
+                        }
                         break;
                 }
             }
@@ -181,6 +277,21 @@ namespace CameraCapture
             stopCompletionSource?.TrySetCanceled();
 
             photoCompletionSource?.TrySetCanceled();
+
+            burstCompletionSource?.TrySetCanceled();
+        }
+
+        // the plugin reuses a burst photo's texture on the next TakePhoto, so each one is copied as it arrives
+        private void OnBurstPhoto(Wrapper.CaptureState state)
+        {
+            var texture = Texture2D.CreateExternalTexture(state.width, state.height, TextureFormat.BGRA32, false, false, state.imgTexture);
+
+            burstPhotos.Add(CopyTexture(texture, burstFlipImage));
+
+            if (burstPhotos.Count == burstCount)
+            {
+                burstCompletionSource.TrySetResult(burstPhotos);
+            }
         }
 
         protected void OnPreviewFrameChanged(Wrapper.CaptureState state)
@@ -255,10 +366,186 @@ namespace CameraCapture
             }
         }
 
+        public void SetFrameDecimation(UInt32 frameInterval, double targetFrameRate)
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.SetFrameDecimation(instanceId, frameInterval, targetFrameRate));
+            }
+        }
+
+        // frames that barely moved or changed get Wrapper.FrameFlags.Redundant in CaptureState.flags,
+        // a maxLumaDifference of 0 compares only the camera pose; while enabled every frame is
+        // located on the payload thread before it is delivered, which adds to its latency
+        public void SetRedundantFrameDetection(bool enable, float maxTranslation = 0.005f, float maxRotationDegrees = 0.5f, float maxLumaDifference = 0.0f, UInt32 maxRedundantFrames = 30)
+        {
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.SetRedundantFrameDetection(instanceId, enable, maxTranslation, maxRotationDegrees, maxLumaDifference, maxRedundantFrames));
+            }
+        }
+
+        public void SetTripleBuffering(bool enable)
+        {
+            TripleBufferVideo = enable;
+
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.SetTripleBuffering(instanceId, enable));
+            }
+        }
+
+        public void SetKeepWarm(bool enable, UInt32 idleTimeoutMs)
+        {
+            KeepWarm = enable;
+            KeepWarmIdleTimeoutMs = idleTimeoutMs;
+
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.SetKeepWarm(instanceId, enable, idleTimeoutMs));
+            }
+        }
+
+        public StartupTimings GetStartupTimings()
+        {
+            StartupTimings timings = new StartupTimings();
+
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.GetStartupTimings(instanceId, out timings));
+            }
+
+            return timings;
+        }
+
+        public TeardownTimings GetTeardownTimings()
+        {
+            TeardownTimings timings = new TeardownTimings();
+
+            if (instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.GetTeardownTimings(instanceId, out timings));
+            }
+
+            return timings;
+        }
+
+        // pose of the camera when a recent frame was captured, timestamp is CaptureState.deviceTimestamp
+        public bool TryGetCameraToWorld(Int64 timestamp, out SpatialTranformHelper.Matrix4x4 cameraToWorld)
+        {
+            cameraToWorld = new SpatialTranformHelper.Matrix4x4();
+
+            if (instanceId == Wrapper.InvalidHandle)
+            {
+                return false;
+            }
+
+            return Native.GetCameraToWorld(instanceId, timestamp, out cameraToWorld) == 0;
+        }
+
+        // pose of the camera predicted to a QPC time in 100ns units, see QpcTimeNow
+        public bool TryPredictCameraToWorld(Int64 targetTime, PosePrediction prediction, out SpatialTranformHelper.Matrix4x4 cameraToWorld)
+        {
+            cameraToWorld = new SpatialTranformHelper.Matrix4x4();
+
+            if (instanceId == Wrapper.InvalidHandle)
+            {
+                return false;
+            }
+
+            return Native.PredictCameraToWorld(instanceId, targetTime, prediction, out cameraToWorld) == 0;
+        }
+
+        // copies the calibration if it changed since changeCount was read, pass 0 the first time
+        public bool TryGetCameraCalibration(ref Int32 changeCount, out CameraCalibration calibration)
+        {
+            calibration = new CameraCalibration();
+
+            if (calibrationPtr == IntPtr.Zero)
+            {
+                if (instanceId == Wrapper.InvalidHandle || Native.GetCameraCalibration(instanceId, out calibrationPtr) != 0)
+                {
+                    return false;
+                }
+            }
+
+            Int32 changeCountOffset = Marshal.OffsetOf(typeof(CameraCalibration), "ChangeCount").ToInt32();
+
+            // the block is written while we copy it at most once per calibration change
+            for (int attempt = 0; attempt < 4; ++attempt)
+            {
+                Int32 before = Marshal.ReadInt32(calibrationPtr, changeCountOffset);
+                if (before == 0 || before == changeCount)
+                {
+                    return false;
+                }
+
+                if ((before & 1) != 0)
+                {
+                    System.Threading.Thread.Yield();
+                    continue;
+                }
+
+                System.Threading.Thread.MemoryBarrier();
+
+                calibration = (CameraCalibration)Marshal.PtrToStructure(calibrationPtr, typeof(CameraCalibration));
+
+                System.Threading.Thread.MemoryBarrier();
+
+                if (Marshal.ReadInt32(calibrationPtr, changeCountOffset) == before && calibration.Version >= CameraCalibration.CurrentVersion)
+                {
+                    changeCount = before;
+
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // the clock of CaptureState.deviceTimestamp, Stopwatch reads the QPC
+        public static Int64 QpcTimeNow()
+        {
+            Int64 ticks = System.Diagnostics.Stopwatch.GetTimestamp();
+            Int64 frequency = System.Diagnostics.Stopwatch.Frequency;
+
+            return (ticks / frequency) * 10000000 + (ticks % frequency) * 10000000 / frequency;
+        }
+
+        // shared by every capture in the process
+        public static LatencyStats GetFrameLatency(LatencyStage stage)
+        {
+            LatencyStats stats = new LatencyStats();
+
+            Native.GetFrameLatencyStats(stage, out stats);
+
+            return stats;
+        }
+
+        public static void ResetFrameLatency()
+        {
+            Native.ResetFrameLatencyStats();
+        }
+
         private void CreateCapture()
         {
             IntPtr thisObjectPtr = GCHandle.ToIntPtr(thisObject);
             CheckHR(Wrapper.CreateCapture(stateChangedCallback, thisObjectPtr, out instanceId));
+
+            if (deliverCallbacksOnRenderEvent && instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Wrapper.SetCallbackDelivery(instanceId, Wrapper.CallbackDelivery.RenderEvent));
+            }
+
+            if (TripleBufferVideo && instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.SetTripleBuffering(instanceId, true));
+            }
+
+            if (KeepWarm && instanceId != Wrapper.InvalidHandle)
+            {
+                CheckHR(Native.SetKeepWarm(instanceId, true, KeepWarmIdleTimeoutMs));
+            }
         }
 
         public async void StartPreview()
@@ -313,6 +600,9 @@ namespace CameraCapture
         {
             stopCompletionSource?.TrySetCanceled();
 
+            // a start that is still running is cancelled by the plugin and never reports back
+            startPreviewCompletionSource?.TrySetCanceled();
+
             var hr = Native.StopPreview(instanceId);
             if (hr == 0)
             {
@@ -345,37 +635,79 @@ namespace CameraCapture
         {
             photoCompletionSource?.TrySetCanceled();
 
-            Texture2D copyTexture = null;
-
             var hr = Native.TakePhoto(instanceId, (UInt32)width, (UInt32)height, useMrc);
+
+            return await ReceivePhotoAsync(hr, width, height, flipImage);
+        }
+
+        // takes count (1 to 20) photos back to back, faster than calling TakePhotoAsync count times
+        public async Task<List<Texture2D>> TakePhotoBurstAsync(int width, int height, int count, bool useMrc, bool flipImage = false)
+        {
+            photoCompletionSource?.TrySetCanceled();
+            burstCompletionSource?.TrySetCanceled();
+
+            List<Texture2D> photos = null;
+
+            var hr = Native.TakePhotoBurst(instanceId, (UInt32)width, (UInt32)height, (UInt32)count, useMrc);
             if (hr == 0)
             {
-                photoCompletionSource = new TaskCompletionSource<Wrapper.CaptureState>();
+                burstPhotos = new List<Texture2D>(count);
+                burstCount = count;
+                burstFlipImage = flipImage;
+                burstCompletionSource = new TaskCompletionSource<List<Texture2D>>();
 
                 try
                 {
-                    var state = await photoCompletionSource.Task;
+                    photos = await burstCompletionSource.Task;
+                }
+                catch (Exception ex)
+                {
+                    Debug.LogError(ex.Message);
+                }
 
-                    if (state.width != width || state.height != height)
-                    {
-                        Debug.Log("Video texture does not match the size requested, using " + state.width + " x " + state.height);
-                    }
+                burstCompletionSource = null;
+                burstPhotos = null;
+            }
+            else
+            {
+                await Task.Yield();
 
-                    if (photoTexture == null)
-                    {
-                        photoTexture = Texture2D.CreateExternalTexture(state.width, state.height, TextureFormat.BGRA32, false, false, state.imgTexture);
-                    }
+                CheckHR(hr);
+            }
 
-                    photoTexture.UpdateExternalTexture(state.imgTexture);
+            return photos;
+        }
 
-                    copyTexture = CopyTexture(photoTexture, flipImage);
+        // copies the latest preview frame, much faster than TakePhotoAsync but at the preview size;
+        // the frame is copied before the call returns, no PhotoFrame callback is raised for it
+        public Task<Texture2D> GrabFrameAsync(bool flipImage = false)
+        {
+            Wrapper.CaptureState state;
 
-                    if (PhotoRenderer != null)
-                    {
-                        PhotoRenderer.enabled = true;
-                        PhotoRenderer.sharedMaterial.SetTexture("_MainTex", photoTexture);
-                        PhotoRenderer.sharedMaterial.SetTextureScale("_MainTex", new Vector2(1, -1)); // flip texture
-                    }
+            var hr = Native.GrabFrame(instanceId, out state);
+            if (hr != 0)
+            {
+                CheckHR(hr);
+
+                return Task.FromResult<Texture2D>(null);
+            }
+
+            return Task.FromResult(ShowPhoto(state, 0, 0, flipImage));
+        }
+
+        private async Task<Texture2D> ReceivePhotoAsync(Int32 hr, int width, int height, bool flipImage)
+        {
+            Texture2D copyTexture = null;
+
+            if (hr == 0)
+            {
+                photoCompletionSource = new TaskCompletionSource<Wrapper.CaptureState>();
+
+                try
+                {
+                    var state = await photoCompletionSource.Task;
+
+                    copyTexture = ShowPhoto(state, width, height, flipImage);
                 }
                 catch (Exception ex)
                 {
@@ -392,6 +724,32 @@ namespace CameraCapture
             return copyTexture;
         }
 
+        private Texture2D ShowPhoto(Wrapper.CaptureState state, int width, int height, bool flipImage)
+        {
+            if (width > 0 && (state.width != width || state.height != height))
+            {
+                Debug.Log("Video texture does not match the size requested, using " + state.width + " x " + state.height);
+            }
+
+            if (photoTexture == null || photoTexture.width != state.width || photoTexture.height != state.height)
+            {
+                photoTexture = Texture2D.CreateExternalTexture(state.width, state.height, TextureFormat.BGRA32, false, false, state.imgTexture);
+            }
+
+            photoTexture.UpdateExternalTexture(state.imgTexture);
+
+            var copyTexture = CopyTexture(photoTexture, flipImage);
+
+            if (PhotoRenderer != null)
+            {
+                PhotoRenderer.enabled = true;
+                PhotoRenderer.sharedMaterial.SetTexture("_MainTex", photoTexture);
+                PhotoRenderer.sharedMaterial.SetTextureScale("_MainTex", new Vector2(1, -1)); // flip texture
+            }
+
+            return copyTexture;
+        }
+
         private Texture2D CopyTexture(Texture2D sourceTexture, bool flipImage = false)
         {
             Texture2D texture2D = null;
@@ -450,8 +808,47 @@ namespace CameraCapture
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetCoordinateSystem")]
             internal static extern Int32 SetCoordinateSystem(Int32 instanceId, IntPtr spatialCoordinateSystemPtr);
 
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureGetCameraToWorld")]
+            internal static extern Int32 GetCameraToWorld(Int32 instanceId, Int64 timestamp, out SpatialTranformHelper.Matrix4x4 cameraToWorld);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CapturePredictCameraToWorld")]
+            internal static extern Int32 PredictCameraToWorld(Int32 instanceId, Int64 targetTime, PosePrediction prediction, out SpatialTranformHelper.Matrix4x4 cameraToWorld);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureGetCameraCalibration")]
+            internal static extern Int32 GetCameraCalibration(Int32 instanceId, out IntPtr calibration);
+
             [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureTakePhoto")]
             internal static extern Int32 TakePhoto(Int32 instanceId, UInt32 width, UInt32 height, [MarshalAs(UnmanagedType.I1)]Boolean enableMrc);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureTakePhotoBurst")]
+            internal static extern Int32 TakePhotoBurst(Int32 instanceId, UInt32 width, UInt32 height, UInt32 count, [MarshalAs(UnmanagedType.I1)]Boolean enableMrc);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureGrabFrame")]
+            internal static extern Int32 GrabFrame(Int32 instanceId, out Wrapper.CaptureState state);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetFrameDecimation")]
+            internal static extern Int32 SetFrameDecimation(Int32 instanceId, UInt32 frameInterval, double targetFrameRate);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetRedundantFrameDetection")]
+            internal static extern Int32 SetRedundantFrameDetection(Int32 instanceId, [MarshalAs(UnmanagedType.I1)]Boolean enable, float maxTranslation, float maxRotationDegrees, float maxLumaDifference, UInt32 maxRedundantFrames);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetTripleBuffering")]
+            internal static extern Int32 SetTripleBuffering(Int32 instanceId, [MarshalAs(UnmanagedType.I1)]Boolean enable);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureSetKeepWarm")]
+            internal static extern Int32 SetKeepWarm(Int32 instanceId, [MarshalAs(UnmanagedType.I1)]Boolean enable, UInt32 idleTimeoutMs);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureGetStartupTimings")]
+            internal static extern Int32 GetStartupTimings(Int32 instanceId, out StartupTimings timings);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "CaptureGetTeardownTimings")]
+            internal static extern Int32 GetTeardownTimings(Int32 instanceId, out TeardownTimings timings);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "GetFrameLatencyStats")]
+            internal static extern Int32 GetFrameLatencyStats(LatencyStage stage, out LatencyStats stats);
+
+            [DllImport(Wrapper.ModuleName, CallingConvention = CallingConvention.StdCall, EntryPoint = "ResetFrameLatencyStats")]
+            internal static extern void ResetFrameLatencyStats();
         }
     }
 }